@@ -0,0 +1,237 @@
+#include "async_output.hpp"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+// The ring needs IORING_OP_WRITE and IORING_FEAT_RW_CUR_POS, both from the
+// 5.6 kernel headers. Built against older ones, every chunk goes out with
+// a plain write.
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+#if defined(IORING_FEAT_RW_CUR_POS) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define ICPC_HAVE_IO_URING 1
+#else
+#define ICPC_HAVE_IO_URING 0
+#endif
+
+#if ICPC_HAVE_IO_URING
+namespace {
+
+int io_uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    int result;
+    do {
+        result = static_cast<int>(
+            syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+    } while (result < 0 && errno == EINTR);
+    return result;
+}
+
+void* map_ring(int ring_fd, std::size_t size, off_t offset) {
+    return mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, offset);
+}
+
+}  // namespace
+
+// The shared submission and completion queues. With one write in flight
+// at a time, two entries are plenty.
+struct AsyncOutputBuffer::Ring {
+    void* sq_mapping = MAP_FAILED;
+    std::size_t sq_mapping_size = 0;
+    void* cq_mapping = MAP_FAILED;
+    std::size_t cq_mapping_size = 0;
+    void* sqe_mapping = MAP_FAILED;
+    std::size_t sqe_mapping_size = 0;
+
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    io_uring_sqe* sqes = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    ~Ring() {
+        if (sqe_mapping != MAP_FAILED) munmap(sqe_mapping, sqe_mapping_size);
+        if (cq_mapping != MAP_FAILED && cq_mapping != sq_mapping) munmap(cq_mapping, cq_mapping_size);
+        if (sq_mapping != MAP_FAILED) munmap(sq_mapping, sq_mapping_size);
+    }
+};
+#else
+struct AsyncOutputBuffer::Ring {};
+#endif
+
+AsyncOutputBuffer::AsyncOutputBuffer(int output_fd, std::size_t chunk_size)
+    : fd(output_fd), chunk_bytes(chunk_size) {
+    chunks[0].reset(new char[chunk_bytes]);
+    chunks[1].reset(new char[chunk_bytes]);
+    setp(chunks[0].get(), chunks[0].get() + chunk_bytes);
+    if (!setup_ring() && ring_fd >= 0) {
+        close(ring_fd);
+        ring_fd = -1;
+    }
+}
+
+AsyncOutputBuffer::~AsyncOutputBuffer() {
+    sync();
+    ring.reset();
+    if (ring_fd >= 0) close(ring_fd);
+}
+
+bool AsyncOutputBuffer::setup_ring() {
+#if ICPC_HAVE_IO_URING
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ring_fd = io_uring_setup(2, &params);
+    if (ring_fd < 0) return false;
+    // Offset -1 ("the current file position") needs IORING_FEAT_RW_CUR_POS.
+    if (!(params.features & IORING_FEAT_RW_CUR_POS)) return false;
+
+    auto queues = std::make_unique<Ring>();
+    queues->sq_mapping_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    queues->cq_mapping_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mapping = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mapping) {
+        queues->sq_mapping_size = std::max(queues->sq_mapping_size, queues->cq_mapping_size);
+        queues->cq_mapping_size = queues->sq_mapping_size;
+    }
+    queues->sq_mapping = map_ring(ring_fd, queues->sq_mapping_size, IORING_OFF_SQ_RING);
+    if (queues->sq_mapping == MAP_FAILED) return false;
+    queues->cq_mapping = single_mapping
+                             ? queues->sq_mapping
+                             : map_ring(ring_fd, queues->cq_mapping_size, IORING_OFF_CQ_RING);
+    if (queues->cq_mapping == MAP_FAILED) return false;
+    queues->sqe_mapping_size = params.sq_entries * sizeof(io_uring_sqe);
+    queues->sqe_mapping = map_ring(ring_fd, queues->sqe_mapping_size, IORING_OFF_SQES);
+    if (queues->sqe_mapping == MAP_FAILED) return false;
+
+    char* sq = static_cast<char*>(queues->sq_mapping);
+    char* cq = static_cast<char*>(queues->cq_mapping);
+    queues->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    queues->sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    queues->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    queues->sqes = static_cast<io_uring_sqe*>(queues->sqe_mapping);
+    queues->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    queues->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    queues->cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    queues->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    ring = std::move(queues);
+    return true;
+#else
+    return false;
+#endif
+}
+
+AsyncOutputBuffer::int_type AsyncOutputBuffer::overflow(int_type c) {
+    submit_chunk();
+    if (failed) return traits_type::eof();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int AsyncOutputBuffer::sync() {
+    submit_chunk();
+    if (ring_fd >= 0) wait_for_write();
+    return failed ? -1 : 0;
+}
+
+void AsyncOutputBuffer::submit_chunk() {
+    std::size_t size = static_cast<std::size_t>(pptr() - pbase());
+    if (size > 0 && !failed) {
+        if (ring_fd >= 0) {
+            // The other chunk may still be on its way out.
+            wait_for_write();
+            submit_write(pbase(), size);
+            current ^= 1;
+        } else {
+            write_directly(pbase(), size);
+        }
+    }
+    setp(chunks[current].get(), chunks[current].get() + chunk_bytes);
+}
+
+void AsyncOutputBuffer::submit_write(const char* data, std::size_t size) {
+#if ICPC_HAVE_IO_URING
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+    io_uring_sqe& sqe = ring->sqes[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_WRITE;
+    sqe.fd = fd;
+    sqe.addr = reinterpret_cast<std::uint64_t>(data);
+    sqe.len = static_cast<std::uint32_t>(size);
+    sqe.off = static_cast<std::uint64_t>(-1);
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    pending_data = data;
+    pending_size = size;
+    if (io_uring_enter(ring_fd, 1, 0, 0) < 0) {
+        // The ring is unusable; finish this write and the rest directly.
+        ring.reset();
+        close(ring_fd);
+        ring_fd = -1;
+        pending_size = 0;
+        write_directly(data, size);
+    }
+#else
+    write_directly(data, size);
+#endif
+}
+
+void AsyncOutputBuffer::wait_for_write() {
+#if ICPC_HAVE_IO_URING
+    while (pending_size > 0 && ring_fd >= 0) {
+        unsigned head = *ring->cq_head;
+        if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+            if (io_uring_enter(ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0) {
+                failed = true;
+                pending_size = 0;
+            }
+            continue;
+        }
+        int result = ring->cqes[head & *ring->cq_mask].res;
+        __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+
+        if (result == -EINTR || result == -EAGAIN) {
+            submit_write(pending_data, pending_size);
+        } else if (result <= 0) {
+            failed = true;
+            pending_size = 0;
+        } else if (static_cast<std::size_t>(result) < pending_size) {
+            // Short write, e.g. to a pipe with little room.
+            submit_write(pending_data + result, pending_size - result);
+        } else {
+            pending_size = 0;
+        }
+    }
+#endif
+}
+
+void AsyncOutputBuffer::write_directly(const char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            failed = true;
+            return;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+}
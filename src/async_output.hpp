@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <streambuf>
+
+// Output buffer that hands full chunks to the kernel through io_uring and
+// keeps filling a second chunk while the first is written, so a long
+// SCROLL does not wait on a slow pipe or disk between chunks. Where
+// io_uring is unavailable (old kernels or kernel headers, seccomp) chunks
+// go out with a plain write instead.
+class AsyncOutputBuffer : public std::streambuf {
+public:
+    explicit AsyncOutputBuffer(int fd, std::size_t chunk_bytes = 1 << 20);
+    ~AsyncOutputBuffer() override;
+
+    AsyncOutputBuffer(const AsyncOutputBuffer&) = delete;
+    AsyncOutputBuffer& operator=(const AsyncOutputBuffer&) = delete;
+
+    // False once a write has failed; later output is discarded.
+    bool ok() const { return !failed; }
+
+protected:
+    int_type overflow(int_type c) override;
+    int sync() override;
+
+private:
+    struct Ring;
+
+    bool setup_ring();
+    // Starts writing the filled part of the current chunk and switches to
+    // the other one, after the write still using it has finished.
+    void submit_chunk();
+    void submit_write(const char* data, std::size_t size);
+    void wait_for_write();
+    void write_directly(const char* data, std::size_t size);
+
+    int fd;
+    std::size_t chunk_bytes;
+    std::unique_ptr<char[]> chunks[2];
+    int current = 0;
+    bool failed = false;
+
+    int ring_fd = -1;
+    std::unique_ptr<Ring> ring;
+    // The write in flight, if any; short writes are resubmitted from here.
+    const char* pending_data = nullptr;
+    std::size_t pending_size = 0;
+};
@@ -0,0 +1,202 @@
+#include "command.hpp"
+
+#include <algorithm>
+#include <charconv>
+
+#include "projection.hpp"
+
+using namespace std;
+
+namespace {
+
+// What istream >> treats as whitespace.
+constexpr const char* kBlanks = " \t\n\v\f\r";
+
+// Splits a command line on blanks without copying it.
+class Tokens {
+public:
+    explicit Tokens(string_view line) : rest(line) {}
+
+    string_view next() {
+        size_t begin = rest.find_first_not_of(kBlanks);
+        if (begin == string_view::npos) {
+            rest = {};
+            return {};
+        }
+        rest.remove_prefix(begin);
+        size_t end = min(rest.find_first_of(kBlanks), rest.size());
+        string_view token = rest.substr(0, end);
+        rest.remove_prefix(end);
+        return token;
+    }
+
+    void skip(int count) {
+        while (count-- > 0) next();
+    }
+
+    // A leading integer of the next token, or 0 if it has none.
+    int next_int() {
+        string_view token = next();
+        int value = 0;
+        if (!token.empty() && token[0] == '+') token.remove_prefix(1);
+        from_chars(token.data(), token.data() + token.size(), value);
+        return value;
+    }
+
+    // A non-negative id spanning the whole next token, or -1.
+    long long next_id() {
+        string_view token = next();
+        long long value = -1;
+        auto [end, error] = from_chars(token.data(), token.data() + token.size(), value);
+        return error == errc() && end == token.data() + token.size() && value >= 0 ? value : -1;
+    }
+
+private:
+    string_view rest;
+};
+
+// Value of a "NAME=value" filter, or "ALL" when the filter is absent.
+string filter_value(string_view part) {
+    size_t pos = part.find('=');
+    return pos == string_view::npos ? "ALL" : string(part.substr(pos + 1));
+}
+
+}  // namespace
+
+const char* command_name(CommandType type) {
+    static const char* const names[kCommandTypeCount] = {
+        "ADDTEAM", "START", "SUBMIT", "FLUSH", "FREEZE", "SCROLL",
+        "QUERY_RANKING", "QUERY_SUBMISSION", "QUERY_SUBMISSIONS", "QUERY_PROBLEMS", "QUERY_MEMORY",
+        "QUERY_PROJECTION",
+        "WATCH", "UNWATCH", "END", "UNKNOWN",
+    };
+    return names[static_cast<int>(type)];
+}
+
+CommandType execute_command(ICPCManagement& system, string_view line) {
+    Tokens tokens(line);
+    string_view command = tokens.next();
+
+    if (command == "ADDTEAM") {
+        system.add_team(string(tokens.next()));
+        return CommandType::AddTeam;
+    }
+    if (command == "START") {
+        tokens.skip(1);
+        int duration = tokens.next_int();
+        tokens.skip(1);
+        int problems = tokens.next_int();
+        system.start_competition(duration, problems);
+        return CommandType::Start;
+    }
+    if (command == "SUBMIT") {
+        string problem(tokens.next());
+        tokens.skip(1);
+        string team_name(tokens.next());
+        tokens.skip(1);
+        string status(tokens.next());
+        tokens.skip(1);
+        int time = tokens.next_int();
+        long long submission_id = -1;
+        if (tokens.next() == "ID") {
+            submission_id = tokens.next_id();
+        }
+        system.submit(problem, team_name, status, time, submission_id);
+        return CommandType::Submit;
+    }
+    if (command == "FLUSH") {
+        system.flush_scoreboard();
+        return CommandType::Flush;
+    }
+    if (command == "FREEZE") {
+        system.freeze_scoreboard();
+        return CommandType::Freeze;
+    }
+    if (command == "SCROLL") {
+        system.scroll_scoreboard();
+        return CommandType::Scroll;
+    }
+    if (command == "QUERY_RANKING") {
+        system.query_ranking(string(tokens.next()));
+        return CommandType::QueryRanking;
+    }
+    if (command == "QUERY_SUBMISSION") {
+        string team_name(tokens.next());
+        tokens.skip(1);
+        string_view problem_part = tokens.next();
+        tokens.skip(1);
+        string_view status_part = tokens.next();
+
+        string problem, status;
+        size_t problem_pos = problem_part.find('=');
+        size_t status_pos = status_part.find('=');
+
+        if (problem_pos != string_view::npos) {
+            problem = string(problem_part.substr(problem_pos + 1));
+        }
+        if (status_pos != string_view::npos) {
+            status = string(status_part.substr(status_pos + 1));
+        }
+
+        system.query_submission(team_name, problem, status);
+        return CommandType::QuerySubmission;
+    }
+    if (command == "QUERY_SUBMISSIONS") {
+        string team_name(tokens.next());
+        tokens.skip(1);
+        int from_time = tokens.next_int();
+        tokens.skip(1);
+        int to_time = tokens.next_int();
+        tokens.skip(1);
+        string_view problem_part = tokens.next();
+        tokens.skip(1);
+        string_view status_part = tokens.next();
+
+        system.query_submissions(team_name, from_time, to_time, filter_value(problem_part),
+                                 filter_value(status_part));
+        return CommandType::QuerySubmissions;
+    }
+    if (command == "QUERY_PROBLEMS") {
+        system.query_problems();
+        return CommandType::QueryProblems;
+    }
+    if (command == "QUERY_MEMORY") {
+        system.query_memory();
+        return CommandType::QueryMemory;
+    }
+    if (command == "QUERY_PROJECTION") {
+        tokens.skip(1);
+        int top = tokens.next_int();
+        int trials = kDefaultProjectionTrials;
+        if (tokens.next() == "TRIALS") {
+            trials = tokens.next_int();
+        }
+        system.query_projection(top, trials);
+        return CommandType::QueryProjection;
+    }
+    if (command == "WATCH") {
+        system.watch_team(string(tokens.next()));
+        return CommandType::Watch;
+    }
+    if (command == "UNWATCH") {
+        system.unwatch_team(string(tokens.next()));
+        return CommandType::Unwatch;
+    }
+    if (command == "END") {
+        system.end_competition();
+        return CommandType::End;
+    }
+    return CommandType::Unknown;
+}
+
+string command_team(string_view line) {
+    Tokens tokens(line);
+    string_view command = tokens.next();
+    if (command == "SUBMIT") {
+        tokens.skip(2);
+    } else if (command != "ADDTEAM" && command != "QUERY_RANKING" && command != "QUERY_SUBMISSION" &&
+               command != "QUERY_SUBMISSIONS" && command != "WATCH" && command != "UNWATCH") {
+        return "";
+    }
+    return string(tokens.next());
+}
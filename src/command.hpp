@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "icpc_management.hpp"
+
+enum class CommandType {
+    AddTeam,
+    Start,
+    Submit,
+    Flush,
+    Freeze,
+    Scroll,
+    QueryRanking,
+    QuerySubmission,
+    QuerySubmissions,
+    QueryProblems,
+    QueryMemory,
+    QueryProjection,
+    Watch,
+    Unwatch,
+    End,
+    Unknown,
+};
+
+constexpr int kCommandTypeCount = static_cast<int>(CommandType::Unknown) + 1;
+
+const char* command_name(CommandType type);
+
+// Parses one input line and applies it to the system. Returns the kind
+// of command that was run; the caller stops reading after End.
+CommandType execute_command(ICPCManagement& system, std::string_view line);
+
+// The team a command line names, or "" for commands that name none.
+std::string command_team(std::string_view line);
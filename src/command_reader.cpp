@@ -0,0 +1,105 @@
+#include "command_reader.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// How far ahead of the cursor the kernel is asked to read, and how much
+// already-parsed input is dropped from the mapping at a time.
+constexpr std::size_t kAdviseWindow = 8 << 20;
+
+std::size_t page_floor(std::size_t offset) {
+    static const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return offset & ~(page - 1);
+}
+
+}  // namespace
+
+CommandReader::CommandReader(const std::string& path) {
+    int fd = STDIN_FILENO;
+    if (!path.empty()) {
+        owned_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (owned_fd < 0) return;
+        fd = owned_fd;
+    }
+    if (map(fd)) {
+        opened = true;
+        return;
+    }
+    if (path.empty()) {
+        stream = &std::cin;
+    } else {
+        file.open(path);
+        stream = &file;
+    }
+    opened = static_cast<bool>(*stream);
+}
+
+CommandReader::~CommandReader() {
+    if (data) munmap(const_cast<char*>(data), size);
+    if (owned_fd >= 0) close(owned_fd);
+}
+
+// Maps `fd` if it is a regular file. Reading starts at the descriptor's
+// current offset, as it would through the stream.
+bool CommandReader::map(int fd) {
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) return false;
+    off_t offset = lseek(fd, 0, SEEK_CUR);
+    if (offset < 0) return false;
+
+    cursor = static_cast<std::size_t>(offset);
+    size = static_cast<std::size_t>(info.st_size);
+    if (cursor >= size) return true;
+
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) return false;
+    data = static_cast<const char*>(mapping);
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    advised = page_floor(cursor);
+    dropped = 0;
+    advise_ahead(cursor);
+    return true;
+}
+
+// Keeps kAdviseWindow of read-ahead in front of the cursor and drops the
+// pages behind it, so a replay's resident input stays flat however long
+// the log is.
+void CommandReader::advise_ahead(std::size_t line_begin) {
+    char* base = const_cast<char*>(data);
+    if (advised < size) {
+        std::size_t length = std::min(kAdviseWindow, size - advised);
+        madvise(base + advised, length, MADV_WILLNEED);
+        advised += length;
+    }
+    std::size_t done = page_floor(line_begin);
+    if (done >= dropped + kAdviseWindow) {
+        madvise(base + dropped, done - dropped, MADV_DONTNEED);
+        dropped = done;
+    }
+}
+
+bool CommandReader::next(std::string_view& line) {
+    if (stream) {
+        if (!std::getline(*stream, buffer)) return false;
+        line = buffer;
+        return true;
+    }
+    if (cursor >= size) return false;
+
+    const char* begin = data + cursor;
+    const char* end = static_cast<const char*>(std::memchr(begin, '\n', size - cursor));
+    std::size_t length = end ? static_cast<std::size_t>(end - begin) : size - cursor;
+    line = std::string_view(begin, length);
+    std::size_t line_begin = cursor;
+    cursor += length + (end ? 1 : 0);
+    if (cursor + kAdviseWindow / 2 > advised) advise_ahead(line_begin);
+    return true;
+}
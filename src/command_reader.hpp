@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <istream>
+#include <string>
+#include <string_view>
+
+// Yields command lines from a file or from stdin. A regular file is mapped
+// and its lines are views into the mapping, so replaying an archived log
+// copies nothing; pipes and terminals fall back to getline.
+class CommandReader {
+public:
+    // Reads `path`, or stdin if it is empty.
+    explicit CommandReader(const std::string& path);
+    ~CommandReader();
+
+    CommandReader(const CommandReader&) = delete;
+    CommandReader& operator=(const CommandReader&) = delete;
+
+    bool ok() const { return opened; }
+
+    // The next line without its '\n'. It stays valid until the next call.
+    bool next(std::string_view& line);
+
+private:
+    bool map(int fd);
+    void advise_ahead(std::size_t line_begin);
+
+    bool opened = false;
+    int owned_fd = -1;
+
+    // Mapped input: [data, data + size), with `cursor` at the next line.
+    const char* data = nullptr;
+    std::size_t size = 0;
+    std::size_t cursor = 0;
+    // Everything before here has been advised MADV_WILLNEED.
+    std::size_t advised = 0;
+    // Everything before here has been dropped with MADV_DONTNEED.
+    std::size_t dropped = 0;
+
+    // Stream input.
+    std::ifstream file;
+    std::istream* stream = nullptr;
+    std::string buffer;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+
+// State summary for diagnostics such as the slow-command log.
+struct ContestShape {
+    long long teams = 0;
+    // Problems with submissions hidden by the freeze, over all teams.
+    long long frozen_problems = 0;
+    // Teams whose visible state changed since the last flush.
+    long long dirty_teams = 0;
+    long long submissions = 0;
+    // Submissions of the team asked about; -1 if it is unknown or the
+    // engine keeps no per-team history.
+    long long team_submissions = -1;
+};
+
+// Commands accepted once the competition has started. START picks the
+// engine instantiation; everything after it is forwarded through here.
+class Contest {
+public:
+    virtual ~Contest() = default;
+
+    virtual void submit(const std::string& problem, const std::string& team_name,
+                        const std::string& status, int time) = 0;
+    virtual void flush_scoreboard() = 0;
+    virtual void freeze_scoreboard() = 0;
+    virtual void scroll_scoreboard() = 0;
+    virtual void query_ranking(const std::string& team_name) = 0;
+    virtual void query_submission(const std::string& team_name, const std::string& problem,
+                                  const std::string& status) = 0;
+    // Every submission of a team with time in [from_time, to_time], oldest
+    // first; problem and status accept "ALL".
+    virtual void query_submissions(const std::string& team_name, int from_time, int to_time,
+                                   const std::string& problem, const std::string& status) = 0;
+    // Visible solved/attempted team counts and first solver per problem.
+    virtual void query_problems() = 0;
+    // Watched teams get a notification whenever a flush changes their
+    // rank, and one per SCROLL if it does.
+    virtual void watch_team(const std::string& team_name) = 0;
+    virtual void unwatch_team(const std::string& team_name) = 0;
+    virtual void end_competition() = 0;
+    // Bytes held, peak bytes and allocation count per engine subsystem.
+    virtual void query_memory() = 0;
+    // Share of `trials` random unfreeze outcomes in which each team ends in
+    // the top `top` places; see projection.hpp for the model.
+    virtual void query_projection(int top, int trials) = 0;
+
+    virtual ContestShape shape(const std::string& team_name) const = 0;
+};
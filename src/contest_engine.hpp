@@ -0,0 +1,1105 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory_resource>
+#include <ostream>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "contest.hpp"
+#include "huge_page_arena.hpp"
+#include "memory_account.hpp"
+#include "metrics.hpp"
+#include "options.hpp"
+#include "problem_id.hpp"
+#include "projection.hpp"
+#include "submission.hpp"
+#include "submission_store.hpp"
+#include "trace.hpp"
+
+// One bit per problem; contests of up to 32 problems keep 32-bit masks.
+template <int Width>
+using ProblemMask = std::conditional_t<(Width <= 32), std::uint32_t, std::uint64_t>;
+
+template <class Mask>
+inline int lowest_problem(Mask mask) {
+    if constexpr (sizeof(Mask) <= sizeof(unsigned)) {
+        return __builtin_ctz(mask);
+    } else {
+        return __builtin_ctzll(mask);
+    }
+}
+
+struct ProblemStatus {
+    int wrong_before = 0;
+    int solved_time = -1;
+    // Submissions made while the scoreboard is frozen stay here, hidden
+    // from the ranking, until SCROLL unfreezes the problem.
+    int submissions_after_freeze = 0;
+    int frozen_wrong_before = 0;
+    int frozen_accept_time = -1;
+    std::uint32_t frozen_accept_seq = 0;
+
+    bool solved() const { return solved_time >= 0; }
+    bool is_frozen() const { return submissions_after_freeze > 0; }
+};
+
+// Last submission of one team for one (problem, status) pair. Kept
+// instead of the full history when history is switched off.
+struct LastSubmission {
+    int time = -1;
+    // 1-based position in the global submission order, 0 if none.
+    std::uint32_t seq = 0;
+};
+
+// Visible totals for one problem, kept up to date as submissions arrive
+// and as SCROLL reveals frozen ones.
+struct ProblemStats {
+    int solved_teams = 0;
+    int attempted_teams = 0;
+    int first_solver = -1;
+    int first_solve_time = -1;
+    std::uint32_t first_solve_seq = 0;
+
+    // Earliest solve wins; equal times go to the earlier submission.
+    void record_solve(int team, int time, std::uint32_t seq) {
+        solved_teams++;
+        if (first_solver < 0 || time < first_solve_time ||
+            (time == first_solve_time && seq < first_solve_seq)) {
+            first_solver = team;
+            first_solve_time = time;
+            first_solve_seq = seq;
+        }
+    }
+};
+
+// Per-team state for a contest of at most Width problems. Problems past
+// the real problem count are never submitted to and stay inert, so every
+// per-team loop runs over a compile-time bound.
+template <int Width>
+struct Team {
+    // Ranking key first, so comparisons touch as few cache lines as possible.
+    // Policy score of the visible solved problems; the solve count under ICPC.
+    long long score = 0;
+    long long penalty_time = 0;
+    // Solve times of the visible solved problems, largest first, zero padded.
+    std::array<int, Width> solved_times{};
+    int solved_count = 0;
+    ProblemMask<Width> frozen_mask = 0;
+    // Names too long for the short-string buffer draw from `account`.
+    CountedString name;
+    std::array<ProblemStatus, Width> problems{};
+
+    Team(std::string_view n, MemoryAccount* account) : name(n, CountingAllocator<char>(account)) {}
+
+    template <class Rules>
+    void calculate_ranking(const Rules& rules) {
+        solved_count = 0;
+        penalty_time = 0;
+        score = 0;
+        solved_times.fill(0);
+
+        for (int i = 0; i < Width; i++) {
+            const auto& status = problems[i];
+            if (status.solved()) {
+                solved_times[solved_count++] = status.solved_time;
+                score += rules.problem_score(i);
+                penalty_time += rules.problem_penalty(status.wrong_before, status.solved_time);
+            }
+        }
+        if constexpr (Rules::kSolveTimeTiebreak) {
+            std::sort(solved_times.begin(), solved_times.begin() + solved_count, std::greater<int>());
+        }
+    }
+};
+
+// Also orders the keys QUERY_PROJECTION builds, which carry the same
+// ranking fields as a team.
+template <int Width, class Rules>
+struct TeamComparator {
+    template <class Key>
+    bool operator()(const Key& a, const Key& b) const {
+        if (a.score != b.score) {
+            return a.score > b.score;
+        }
+        if (a.penalty_time != b.penalty_time) {
+            return a.penalty_time < b.penalty_time;
+        }
+        if constexpr (Rules::kSolveTimeTiebreak) {
+            // Shorter lists are zero padded; a longer list has a larger
+            // entry where the shorter one has zero and so compares later.
+            for (int i = 0; i < Width; i++) {
+                if (a.solved_times[i] != b.solved_times[i]) {
+                    return a.solved_times[i] < b.solved_times[i];
+                }
+            }
+        }
+        return a.name < b.name;
+    }
+};
+
+// Orders team ids by the teams they index.
+template <int Width, class Rules>
+struct TeamIdComparator {
+    const Team<Width>* teams;
+
+    bool operator()(int a, int b) const {
+        return TeamComparator<Width, Rules>()(teams[a], teams[b]);
+    }
+};
+
+// The roster is fixed at START, so teams live in one array and are
+// referred to by index. The flushed scoreboard is kept as a sorted id
+// array plus a dense rank array, which makes QUERY_RANKING O(1). FLUSH
+// only re-sorts the teams whose visible state changed and splices them
+// back in, O(N + D log N) for D changed teams, and SCROLL moves one team
+// per unfreeze in an ordered set, O((N + F) log N) for F frozen problems.
+template <int Width, class Rules>
+class ContestEngine : public Contest {
+    static_assert(Width <= kMaxProblems, "problem masks are at most 64 bits wide");
+
+public:
+    using TeamType = Team<Width>;
+    using Mask = ProblemMask<Width>;
+    using IdComparator = TeamIdComparator<Width, Rules>;
+    using Ranking = std::set<int, IdComparator, CountingAllocator<int>>;
+
+    ContestEngine(const std::vector<std::string>& roster, int duration, int problems,
+                  const Rules& contest_rules, const ContestOptions& options, std::ostream& output)
+        : memory(long_lived_resource(options.allocator), transient_resource(options.allocator)),
+          out(output), rules(contest_rules), auto_flush(options.auto_flush),
+          keep_history(options.keep_history), projection_threads(options.projection_threads),
+          history(options.keep_history ? roster.size() : 0, memory[MemorySubsystem::History]),
+          duration_time(duration), problem_count(std::min(problems, Width)) {
+        // Ids are handed out in name order: with nothing solved yet that is
+        // also the ranking the README prescribes before the first flush.
+        std::vector<std::string_view> names(roster.begin(), roster.end());
+        std::sort(names.begin(), names.end());
+
+        // Never grown after this, so the name views in `teams` stay valid.
+        team_list.reserve(names.size());
+        teams.reserve(names.size());
+        scoreboard.reserve(names.size());
+        ranks.resize(names.size());
+        dirty.resize(names.size());
+        for (std::string_view name : names) {
+            int id = static_cast<int>(team_list.size());
+            team_list.emplace_back(name, memory[MemorySubsystem::Teams]);
+            teams.emplace(team_list.back().name, id);
+            scoreboard.push_back(id);
+        }
+        assign_ranks();
+
+        if (!keep_history) {
+            last_submissions.resize(names.size() * problem_count * kStatusCount);
+        }
+    }
+
+    void submit(const std::string& problem, const std::string& team_name,
+                const std::string& status, int time) override {
+        if (competition_ended) return;
+
+        // Pending auto flushes wait until the clock moves on, so a burst of
+        // submissions at one time costs a single flush.
+        if (flush_pending && time > pending_flush_time) {
+            run_auto_flush();
+        }
+        latest_time = std::max(latest_time, time);
+
+        auto it = teams.find(team_name);
+        if (it == teams.end()) return;
+
+        int id = it->second;
+        TeamType& team = team_list[id];
+        int prob_index = problem_index(problem);
+        if (prob_index < 0 || prob_index >= problem_count) return;
+
+        SubmitStatus verdict;
+        if (!parse_status(status, verdict)) return;
+
+        std::uint32_t seq = ++submission_count;
+        Metrics::add(Metrics::global().submissions, 1);
+        if (keep_history) {
+            history.append(id, prob_index, verdict, time);
+        } else {
+            // A late arrival doesn't displace a later submission.
+            LastSubmission& last = last_submission(id, prob_index, verdict);
+            if (time >= last.time) {
+                last.time = time;
+                last.seq = seq;
+            }
+        }
+        ProblemStatus& prob_status = team.problems[prob_index];
+        if (prob_status.solved()) return;
+
+        bool accepted = verdict == SubmitStatus::Accepted;
+        if (is_frozen) {
+            if (prob_status.submissions_after_freeze++ == 0) {
+                frozen_problem_count++;
+                Metrics::add(Metrics::global().frozen_problems, 1);
+                if (!team.frozen_mask) Metrics::add(Metrics::global().teams_with_frozen_problems, 1);
+            }
+            team.frozen_mask |= Mask(1) << prob_index;
+            if (prob_status.frozen_accept_time < 0) {
+                if (accepted) {
+                    prob_status.frozen_accept_time = time;
+                    prob_status.frozen_accept_seq = seq;
+                } else {
+                    prob_status.frozen_wrong_before++;
+                }
+            }
+            return;
+        }
+
+        ProblemStats& stats = problem_stats[prob_index];
+        if (prob_status.wrong_before == 0) {
+            stats.attempted_teams++;
+        }
+        if (accepted) {
+            prob_status.solved_time = time;
+            stats.record_solve(id, time, seq);
+        } else {
+            prob_status.wrong_before++;
+        }
+        if (!dirty[id]) {
+            dirty[id] = true;
+            dirty_teams.push_back(id);
+        }
+
+        if (auto_flush.enabled()) {
+            changes_since_flush++;
+            if (!flush_pending && auto_flush_due(id, accepted, time)) {
+                flush_pending = true;
+                pending_flush_time = time;
+            }
+        }
+    }
+
+    void flush_scoreboard() override {
+        if (competition_ended) return;
+
+        remember_watched_ranks();
+        flush_rankings();
+        out << "[Info]Flush scoreboard.\n";
+        report_watched_moves();
+    }
+
+    void freeze_scoreboard() override {
+        if (competition_ended) return;
+        settle_auto_flush();
+
+        if (is_frozen) {
+            out << "[Error]Freeze failed: scoreboard has been frozen.\n";
+            return;
+        }
+
+        is_frozen = true;
+        freeze_time = latest_time;
+        out << "[Info]Freeze scoreboard.\n";
+    }
+
+    void scroll_scoreboard() override {
+        if (competition_ended) return;
+        settle_auto_flush();
+
+        if (!is_frozen) {
+            out << "[Error]Scroll failed: scoreboard has not been frozen.\n";
+            return;
+        }
+
+        out << "[Info]Scroll scoreboard.\n";
+
+        // Track the engine's high-water mark over this scroll alone.
+        long long peak_before = memory.total.peak_bytes;
+        memory.total.peak_bytes = memory.total.bytes;
+
+        // Watched teams get one line for the whole scroll, implicit flush
+        // included, however often they move in between.
+        remember_watched_ranks();
+        flush_rankings();
+        print_scoreboard();
+
+        CountingAllocator<int> scroll_allocator(memory[MemorySubsystem::Scroll]);
+        Ranking ranking(id_comparator(), scroll_allocator);
+        Ranking frozen_teams(id_comparator(), scroll_allocator);
+        {
+            TraceSpan span("scroll.build");
+            for (int id : scoreboard) {
+                ranking.insert(ranking.end(), id);
+                if (team_list[id].frozen_mask) {
+                    frozen_teams.insert(frozen_teams.end(), id);
+                }
+            }
+        }
+
+        while (!frozen_teams.empty()) {
+            TraceSpan span("scroll.step");
+            Metrics::add(Metrics::global().scroll_steps, 1);
+            // Lowest-ranked team that still has frozen problems
+            auto target_it = std::prev(frozen_teams.end());
+            int target = *target_it;
+            frozen_teams.erase(target_it);
+
+            TeamType& team = team_list[target];
+            if (unfreeze(target, lowest_problem(team.frozen_mask))) {
+                // Both orders agree on every other team, so this is where
+                // the team sat before its key changes.
+                auto old_pos = ranking.find(target);
+                int old_prev = old_pos == ranking.begin() ? -1 : *std::prev(old_pos);
+                ranking.erase(old_pos);
+
+                team.calculate_ranking(rules);
+                auto new_pos = ranking.insert(target).first;
+
+                // The team climbed iff it overtook its old predecessor; the
+                // team now right behind it held the position it took. With
+                // non-positive weights a solve can also move it down.
+                if (old_prev >= 0 && id_comparator()(target, old_prev)) {
+                    out << team.name << " " << team_list[*std::next(new_pos)].name << " "
+                        << team.score << " " << team.penalty_time << "\n";
+                }
+            }
+
+            if (team.frozen_mask) {
+                frozen_teams.insert(target);
+            }
+        }
+
+        scoreboard.assign(ranking.begin(), ranking.end());
+        assign_ranks();
+        print_scoreboard();
+        report_watched_moves();
+
+        is_frozen = false;
+        scroll_peak_bytes = memory.total.peak_bytes;
+        memory.total.peak_bytes = std::max(peak_before, scroll_peak_bytes);
+    }
+
+    void query_ranking(const std::string& team_name) override {
+        settle_auto_flush();
+        auto it = teams.find(team_name);
+        if (it == teams.end()) {
+            out << "[Error]Query ranking failed: cannot find the team.\n";
+            return;
+        }
+
+        out << "[Info]Complete query ranking.\n";
+        if (is_frozen) {
+            out << "[Warning]Scoreboard is frozen. The ranking may be inaccurate until it were scrolled.\n";
+        }
+        out << "[" << team_name << "] NOW AT RANKING [" << ranks[it->second] << "]\n";
+    }
+
+    void query_submission(const std::string& team_name, const std::string& problem,
+                          const std::string& status) override {
+        auto it = teams.find(team_name);
+        if (it == teams.end()) {
+            out << "[Error]Query submission failed: cannot find the team.\n";
+            return;
+        }
+
+        out << "[Info]Complete query submission.\n";
+
+        bool any_problem = problem == "ALL";
+        int prob_index = any_problem ? -1 : problem_index(problem);
+        SubmitStatus verdict = SubmitStatus::Accepted;
+        bool any_status = !parse_status(status, verdict);
+
+        int first_problem = any_problem ? 0 : prob_index;
+        int last_problem = any_problem ? problem_count - 1 : prob_index;
+        if (first_problem < 0 || last_problem >= problem_count) {
+            out << "Cannot find any submission.\n";
+            return;
+        }
+
+        bool found = false;
+        SubmissionRecord result(0, verdict, 0);
+        if (keep_history) {
+            // Newest time first, so the first match is the latest.
+            for (auto index = history.last_of(it->second); index != SubmissionStore::kNone;
+                 index = history.prev(index)) {
+                if ((any_problem || history.problem(index) == prob_index) &&
+                    (any_status || history.status(index) == verdict)) {
+                    result = history.record(index);
+                    found = true;
+                    break;
+                }
+            }
+        } else {
+            // The latest submission among the matching summary cells, the
+            // later arrival on equal times
+            const LastSubmission* newest = nullptr;
+            for (int p = first_problem; p <= last_problem; p++) {
+                for (int st = 0; st < kStatusCount; st++) {
+                    auto cell_status = static_cast<SubmitStatus>(st);
+                    if (!any_status && cell_status != verdict) continue;
+
+                    const LastSubmission& last = last_submission(it->second, p, cell_status);
+                    if (last.seq == 0) continue;
+                    if (!newest || last.time > newest->time ||
+                        (last.time == newest->time && last.seq > newest->seq)) {
+                        newest = &last;
+                        result = SubmissionRecord(p, cell_status, last.time);
+                    }
+                }
+            }
+            found = newest != nullptr;
+        }
+
+        if (!found) {
+            out << "Cannot find any submission.\n";
+            return;
+        }
+        out << "[" << team_name << "] [" << problem_name(result.problem) << "] ["
+            << status_name(result.status) << "] [" << result.time << "]\n";
+    }
+
+    void query_submissions(const std::string& team_name, int from_time, int to_time,
+                           const std::string& problem, const std::string& status) override {
+        auto it = teams.find(team_name);
+        if (it == teams.end()) {
+            out << "[Error]Query submissions failed: cannot find the team.\n";
+            return;
+        }
+        if (!keep_history) {
+            out << "[Error]Query submissions failed: submission history is disabled.\n";
+            return;
+        }
+
+        out << "[Info]Complete query submissions.\n";
+
+        bool any_problem = problem == "ALL";
+        int prob_index = any_problem ? -1 : problem_index(problem);
+        SubmitStatus verdict = SubmitStatus::Accepted;
+        bool any_status = !parse_status(status, verdict);
+
+        // The team's chain is sorted by time, late arrivals included, newest
+        // first: collect the matches back to from_time, then print them
+        // oldest first.
+        std::vector<std::uint32_t> matches;
+        for (auto index = history.last_at_or_before(it->second, to_time);
+             index != SubmissionStore::kNone && history.time(index) >= from_time;
+             index = history.prev(index)) {
+            if ((any_problem || history.problem(index) == prob_index) &&
+                (any_status || history.status(index) == verdict)) {
+                matches.push_back(index);
+            }
+        }
+        for (auto index = matches.rbegin(); index != matches.rend(); ++index) {
+            out << "[" << team_name << "] [" << problem_name(history.problem(*index)) << "] ["
+                << status_name(history.status(*index)) << "] [" << history.time(*index) << "]\n";
+        }
+        if (matches.empty()) {
+            out << "Cannot find any submission.\n";
+        }
+    }
+
+    void query_problems() override {
+        out << "[Info]Complete query problems.\n";
+        for (int i = 0; i < problem_count; i++) {
+            const ProblemStats& stats = problem_stats[i];
+            out << "[" << problem_name(i) << "] [" << stats.solved_teams << "] ["
+                << stats.attempted_teams << "]";
+            if (stats.first_solver >= 0) {
+                out << " [" << team_list[stats.first_solver].name << "] [" << stats.first_solve_time << "]";
+            }
+            out << "\n";
+        }
+    }
+
+    void watch_team(const std::string& team_name) override {
+        auto it = teams.find(team_name);
+        if (it == teams.end()) {
+            out << "[Error]Watch failed: cannot find the team.\n";
+            return;
+        }
+        if (std::find(watched_teams.begin(), watched_teams.end(), it->second) != watched_teams.end()) {
+            out << "[Error]Watch failed: team is already watched.\n";
+            return;
+        }
+        watched_teams.push_back(it->second);
+        out << "[Info]Watch successfully.\n";
+    }
+
+    void unwatch_team(const std::string& team_name) override {
+        auto it = teams.find(team_name);
+        auto watched = it == teams.end() ? watched_teams.end()
+                                         : std::find(watched_teams.begin(), watched_teams.end(), it->second);
+        if (watched == watched_teams.end()) {
+            out << "[Error]Unwatch failed: team is not watched.\n";
+            return;
+        }
+        watched_teams.erase(watched);
+        out << "[Info]Unwatch successfully.\n";
+    }
+
+    void end_competition() override {
+        if (competition_ended) return;
+
+        competition_ended = true;
+        out << "[Info]Competition ends.\n";
+    }
+
+    void query_memory() override {
+        out << "[Info]Complete query memory.\n";
+        for (int i = 0; i < kMemorySubsystemCount; i++) {
+            print_memory_account(memory_subsystem_name(static_cast<MemorySubsystem>(i)),
+                                 memory.subsystems[i]);
+        }
+        print_memory_account("total", memory.total);
+        out << "[scroll_peak] [" << scroll_peak_bytes << "]\n";
+    }
+
+    void query_projection(int top, int trials) override {
+        if (!is_frozen) {
+            out << "[Error]Query projection failed: scoreboard is not frozen.\n";
+            return;
+        }
+        if (top < 1 || trials < 1 || trials > kMaxProjectionTrials) {
+            out << "[Error]Query projection failed: invalid parameters.\n";
+            return;
+        }
+
+        std::vector<long long> hits = project_standings(top, trials);
+        // Ids are in name order, which breaks ties.
+        std::vector<int> order;
+        for (int id = 0; id < static_cast<int>(hits.size()); id++) {
+            if (hits[id] > 0) order.push_back(id);
+        }
+        std::stable_sort(order.begin(), order.end(),
+                         [&hits](int a, int b) { return hits[a] > hits[b]; });
+
+        out << "[Info]Complete query projection.\n";
+        for (int id : order) {
+            print_projection(out, team_list[id].name, hits[id], trials);
+        }
+    }
+
+    ContestShape shape(const std::string& team_name) const override {
+        ContestShape result;
+        result.teams = static_cast<long long>(team_list.size());
+        result.frozen_problems = frozen_problem_count;
+        result.dirty_teams = static_cast<long long>(dirty_teams.size());
+        result.submissions = submission_count;
+        auto it = teams.find(team_name);
+        if (it != teams.end() && keep_history) {
+            result.team_submissions = history.count_of(it->second);
+        }
+        return result;
+    }
+
+private:
+    // Used with --allocator=arena or hugepage only; declared first so they
+    // outlive every container drawing from them. None maps anything
+    // before its first allocation.
+    std::pmr::monotonic_buffer_resource arena;
+    HugePageArena huge_pages;
+    std::pmr::unsynchronized_pool_resource pool;
+    // Every container below charges one of these.
+    MemoryAccounts memory;
+    // Engine bytes at their highest during the last SCROLL.
+    long long scroll_peak_bytes = 0;
+    std::ostream& out;
+    Rules rules;
+    AutoFlushPolicy auto_flush;
+    bool flush_pending = false;
+    int pending_flush_time = 0;
+    long long changes_since_flush = 0;
+    int last_flush_time = 0;
+    int latest_time = 0;
+    // latest_time when the board froze: the earliest a frozen solve can be.
+    int freeze_time = 0;
+    CountedVector<TeamType> team_list{CountingAllocator<TeamType>(memory[MemorySubsystem::Teams])};
+    std::unordered_map<std::string_view, int, std::hash<std::string_view>,
+                       std::equal_to<std::string_view>,
+                       CountingAllocator<std::pair<const std::string_view, int>>>
+        teams{CountingAllocator<std::pair<const std::string_view, int>>(
+            memory[MemorySubsystem::NameIndex])};
+    // Team ids in the order of the last flushed scoreboard, and each
+    // team's 1-based position in it.
+    CountedVector<int> scoreboard{ranking_allocator<int>()};
+    CountedVector<int> ranks{ranking_allocator<int>()};
+    // Teams whose visible state changed since the last flush.
+    CountedVector<char> dirty{ranking_allocator<char>()};
+    CountedVector<int> dirty_teams{ranking_allocator<int>()};
+    CountedVector<int> merge_buffer{ranking_allocator<int>()};
+    bool keep_history;
+    int projection_threads;
+    SubmissionStore history;
+    // History-free mode: one cell per (team, problem, status), strided by
+    // the real problem count rather than the width class.
+    CountedVector<LastSubmission> last_submissions{
+        CountingAllocator<LastSubmission>(memory[MemorySubsystem::History])};
+    std::uint32_t submission_count = 0;
+    long long frozen_problem_count = 0;
+    std::array<ProblemStats, Width> problem_stats{};
+    // Watched teams, and their ranks before the flush or scroll that is
+    // under way.
+    CountedVector<int> watched_teams{ranking_allocator<int>()};
+    CountedVector<int> watched_ranks{ranking_allocator<int>()};
+    bool competition_ended = false;
+    int duration_time = 0;
+    int problem_count = 0;
+    bool is_frozen = false;
+
+    IdComparator id_comparator() const { return IdComparator{team_list.data()}; }
+
+    std::pmr::memory_resource* long_lived_resource(AllocatorKind kind) {
+        switch (kind) {
+        case AllocatorKind::Arena:
+            return &arena;
+        case AllocatorKind::HugePages:
+            return &huge_pages;
+        case AllocatorKind::Heap:
+            break;
+        }
+        return std::pmr::new_delete_resource();
+    }
+
+    std::pmr::memory_resource* transient_resource(AllocatorKind kind) {
+        return kind == AllocatorKind::Heap ? std::pmr::new_delete_resource() : &pool;
+    }
+
+    template <class T>
+    CountingAllocator<T> ranking_allocator() {
+        return CountingAllocator<T>(memory[MemorySubsystem::Ranking]);
+    }
+
+    LastSubmission& last_submission(int id, int prob_index, SubmitStatus status) {
+        return last_submissions[(static_cast<size_t>(id) * problem_count + prob_index) * kStatusCount +
+                                static_cast<int>(status)];
+    }
+
+    void assign_ranks() {
+        for (size_t i = 0; i < scoreboard.size(); i++) {
+            ranks[scoreboard[i]] = static_cast<int>(i) + 1;
+        }
+    }
+
+    void flush_rankings() {
+        Metrics::add(Metrics::global().flushes, 1);
+        flush_pending = false;
+        changes_since_flush = 0;
+        last_flush_time = latest_time;
+
+        // Ranks only move when some team's key did.
+        if (dirty_teams.empty()) return;
+
+        auto cmp = id_comparator();
+        {
+            TraceSpan span("flush.rescore");
+            for (int id : dirty_teams) {
+                team_list[id].calculate_ranking(rules);
+            }
+        }
+        {
+            TraceSpan span("flush.sort");
+            std::sort(dirty_teams.begin(), dirty_teams.end(), cmp);
+        }
+
+        TraceSpan merge_span("flush.merge");
+        // Clean teams keep their keys and relative order. Binary searching
+        // each re-sorted dirty team into them and copying the runs between
+        // restores the full order without comparing every clean team.
+        scoreboard.erase(std::remove_if(scoreboard.begin(), scoreboard.end(),
+                                        [this](int id) { return dirty[id]; }),
+                         scoreboard.end());
+        merge_buffer.clear();
+        auto from = scoreboard.begin();
+        for (int id : dirty_teams) {
+            auto pos = std::upper_bound(from, scoreboard.end(), id, cmp);
+            merge_buffer.insert(merge_buffer.end(), from, pos);
+            merge_buffer.push_back(id);
+            from = pos;
+            dirty[id] = false;
+        }
+        merge_buffer.insert(merge_buffer.end(), from, scoreboard.end());
+        scoreboard.swap(merge_buffer);
+
+        dirty_teams.clear();
+        assign_ranks();
+    }
+
+    // Whether a visible submission by team `id` makes an automatic flush
+    // worthwhile under the configured policy.
+    bool auto_flush_due(int id, bool accepted, int time) {
+        if (auto_flush.submissions && changes_since_flush >= auto_flush.submissions) {
+            return true;
+        }
+        if (auto_flush.interval && time - last_flush_time >= auto_flush.interval) {
+            return true;
+        }
+        // Only a solve changes a ranking key. It can reorder the top places
+        // if the team is among them or now beats the last of them.
+        if (auto_flush.top && accepted) {
+            int top = std::min(auto_flush.top, static_cast<int>(scoreboard.size()));
+            if (ranks[id] <= top) return true;
+
+            // Early rescoring is harmless: flushes rescore dirty teams anyway
+            // and never compare them against their stale position.
+            TeamType& team = team_list[id];
+            team.calculate_ranking(rules);
+            return TeamComparator<Width, Rules>()(team, team_list[scoreboard[top - 1]]);
+        }
+        return false;
+    }
+
+    void settle_auto_flush() {
+        if (flush_pending) run_auto_flush();
+    }
+
+    // Automatic flushes print nothing themselves, only watch notifications.
+    void run_auto_flush() {
+        remember_watched_ranks();
+        flush_rankings();
+        report_watched_moves();
+    }
+
+    void remember_watched_ranks() {
+        watched_ranks.clear();
+        for (int id : watched_teams) {
+            watched_ranks.push_back(ranks[id]);
+        }
+    }
+
+    // One line per watched team whose rank differs from the remembered one.
+    void report_watched_moves() {
+        for (size_t i = 0; i < watched_teams.size(); i++) {
+            int id = watched_teams[i];
+            if (ranks[id] != watched_ranks[i]) {
+                out << "[Watch][" << team_list[id].name << "] RANKING [" << watched_ranks[i] << "] -> ["
+                    << ranks[id] << "]\n";
+            }
+        }
+    }
+
+    void print_memory_account(const char* name, const MemoryAccount& account) {
+        out << "[" << name << "] [" << account.bytes << "] [" << account.peak_bytes << "] ["
+            << account.allocations << "]\n";
+    }
+
+    // Reveals the frozen submissions of one problem. Returns whether the
+    // problem turned out to be solved during the freeze.
+    bool unfreeze(int id, int prob_index) {
+        TeamType& team = team_list[id];
+        ProblemStatus& status = team.problems[prob_index];
+        ProblemStats& stats = problem_stats[prob_index];
+        team.frozen_mask &= ~(Mask(1) << prob_index);
+        frozen_problem_count--;
+        Metrics::add(Metrics::global().frozen_problems, -1);
+        if (!team.frozen_mask) Metrics::add(Metrics::global().teams_with_frozen_problems, -1);
+
+        if (status.wrong_before == 0) {
+            stats.attempted_teams++;
+        }
+        status.wrong_before += status.frozen_wrong_before;
+        bool solved = status.frozen_accept_time >= 0;
+        if (solved) {
+            status.solved_time = status.frozen_accept_time;
+            stats.record_solve(id, status.solved_time, status.frozen_accept_seq);
+        }
+
+        status.submissions_after_freeze = 0;
+        status.frozen_wrong_before = 0;
+        status.frozen_accept_time = -1;
+        status.frozen_accept_seq = 0;
+        return solved;
+    }
+
+    // Ranking fields of one team under one projected outcome.
+    struct ProjectedKey {
+        long long score = 0;
+        long long penalty_time = 0;
+        std::array<int, Width> solved_times{};
+        std::string_view name;
+        int id = 0;
+    };
+
+    // A frozen problem of a contender, copied out of its team so that the
+    // trials read one small array instead of the whole roster.
+    struct ProjectedDraw {
+        int problem = 0;
+        int tries = 0;
+        int wrong_before = 0;
+        // The most this and the contender's later frozen problems can add.
+        long long score_left = 0;
+    };
+
+    // A team with frozen problems: its visible key and, in `draws`, the
+    // range [first_draw, last_draw) of its frozen problems.
+    struct ProjectedContender {
+        ProjectedKey base;
+        int visible_solved = 0;
+        int first_draw = 0;
+        int last_draw = 0;
+    };
+
+    // Trials are handed to workers in blocks of this many.
+    static constexpr int kProjectionBlock = 64;
+
+    // Runs the QUERY_PROJECTION trials and returns, per team id, in how
+    // many the team finished in the top `top`. Teams without frozen
+    // problems keep their key in every trial, so only their best `top`
+    // take part. When solves can only help, every team is at least as good
+    // as its visible key, so the `top`-th best visible key bounds the
+    // field: a team whose best case loses to it is never drawn. Within a
+    // trial, drawing for a team stops once its score cannot reach the
+    // current top. Each worker keeps its own keys, counts and a heap of
+    // that top.
+    std::vector<long long> project_standings(int top, int trials) {
+        TraceSpan span("projection");
+        int team_count = static_cast<int>(team_list.size());
+
+        // Rescoring early is harmless, as in auto_flush_due.
+        for (int id : dirty_teams) {
+            team_list[id].calculate_ranking(rules);
+        }
+        std::array<double, Width> accept_rate{};
+        bool solves_only_help = true;
+        for (int j = 0; j < problem_count; j++) {
+            long long tries = 0;
+            long long accepted = 0;
+            for (const TeamType& team : team_list) {
+                const ProblemStatus& status = team.problems[j];
+                tries += status.wrong_before + (status.solved() ? 1 : 0);
+                accepted += status.solved() ? 1 : 0;
+            }
+            accept_rate[j] = projection_accept_rate(accepted, tries);
+            solves_only_help = solves_only_help && rules.problem_score(j) > 0;
+        }
+
+        TeamComparator<Width, Rules> better;
+        std::vector<ProjectedKey> visible(team_count);
+        for (int id = 0; id < team_count; id++) visible[id] = visible_key(id);
+        // At least `top` teams finish no worse than `bar` in every trial.
+        const ProjectedKey* bar = nullptr;
+        ProjectedKey bar_key;
+        if (solves_only_help && team_count > top) {
+            std::vector<ProjectedKey> worst = visible;
+            std::nth_element(worst.begin(), worst.begin() + (top - 1), worst.end(), better);
+            bar_key = worst[top - 1];
+            bar = &bar_key;
+        }
+
+        std::vector<ProjectedKey> settled;
+        std::vector<ProjectedContender> contenders;
+        std::vector<ProjectedDraw> draws;
+        int earliest = earliest_projected_solve(freeze_time);
+        for (int id = 0; id < team_count; id++) {
+            const TeamType& team = team_list[id];
+            if (!team.frozen_mask) {
+                if (!bar || !better(*bar, visible[id])) settled.push_back(visible[id]);
+                continue;
+            }
+            ProjectedContender contender;
+            contender.base = visible[id];
+            contender.visible_solved = team.solved_count;
+            contender.first_draw = static_cast<int>(draws.size());
+            // Solving every frozen problem with no further wrong tries at
+            // the freeze is as good as any outcome gets.
+            ProjectedKey best = visible[id];
+            for (Mask mask = team.frozen_mask; mask; mask &= mask - 1) {
+                int j = lowest_problem(mask);
+                const ProblemStatus& status = team.problems[j];
+                draws.push_back({j, status.submissions_after_freeze, status.wrong_before});
+                add_solve(best, j, status.wrong_before, earliest);
+            }
+            contender.last_draw = static_cast<int>(draws.size());
+            long long score_left = 0;
+            for (int i = contender.last_draw - 1; i >= contender.first_draw; i--) {
+                score_left += std::max<long long>(0, rules.problem_score(draws[i].problem));
+                draws[i].score_left = score_left;
+            }
+            if (bar && better(*bar, best)) {
+                draws.resize(contender.first_draw);
+                continue;
+            }
+            contenders.push_back(contender);
+        }
+        if (static_cast<int>(settled.size()) > top) {
+            std::nth_element(settled.begin(), settled.begin() + (top - 1), settled.end(), better);
+            settled.resize(top);
+        }
+        // Drawing the strongest first fills the top early, so later teams
+        // fall below its cutoff sooner.
+        auto best_score = [&draws](const ProjectedContender& contender) {
+            return contender.base.score + draws[contender.first_draw].score_left;
+        };
+        std::sort(contenders.begin(), contenders.end(),
+                  [&](const ProjectedContender& a, const ProjectedContender& b) {
+                      return best_score(a) > best_score(b);
+                  });
+
+        int blocks = (trials + kProjectionBlock - 1) / kProjectionBlock;
+        int threads = projection_threads > 0
+                          ? projection_threads
+                          : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        threads = std::max(1, std::min(threads, blocks));
+        std::vector<std::vector<long long>> hits(threads, std::vector<long long>(team_count));
+        std::atomic<int> next_block{0};
+
+        auto work = [&](std::vector<long long>& counts) {
+            std::vector<ProjectedKey> keys(contenders.size());
+            // The current top of a trial, worst first.
+            std::vector<const ProjectedKey*> leaders;
+            auto worse = [&better](const ProjectedKey* a, const ProjectedKey* b) {
+                return better(*a, *b);
+            };
+            for (int block; (block = next_block.fetch_add(1)) < blocks;) {
+                int end = std::min(trials, (block + 1) * kProjectionBlock);
+                for (int trial = block * kProjectionBlock; trial < end; trial++) {
+                    leaders.clear();
+                    for (const ProjectedKey& key : settled) leaders.push_back(&key);
+                    std::make_heap(leaders.begin(), leaders.end(), worse);
+                    for (size_t i = 0; i < contenders.size(); i++) {
+                        ProjectedKey& key = keys[i];
+                        bool full = static_cast<int>(leaders.size()) == top;
+                        long long cutoff = full ? leaders.front()->score
+                                                : std::numeric_limits<long long>::min();
+                        if (!project_team(key, contenders[i], draws, trial, accept_rate, cutoff)) {
+                            continue;
+                        }
+                        if (!full) {
+                            leaders.push_back(&key);
+                            std::push_heap(leaders.begin(), leaders.end(), worse);
+                        } else if (better(key, *leaders.front())) {
+                            std::pop_heap(leaders.begin(), leaders.end(), worse);
+                            leaders.back() = &key;
+                            std::push_heap(leaders.begin(), leaders.end(), worse);
+                        }
+                    }
+                    for (const ProjectedKey* key : leaders) counts[key->id]++;
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        for (int i = 1; i < threads; i++) {
+            workers.emplace_back(work, std::ref(hits[i]));
+        }
+        work(hits[0]);
+        for (auto& worker : workers) worker.join();
+
+        for (int i = 1; i < threads; i++) {
+            for (int id = 0; id < team_count; id++) hits[0][id] += hits[i][id];
+        }
+        return std::move(hits[0]);
+    }
+
+    ProjectedKey visible_key(int id) const {
+        const TeamType& team = team_list[id];
+        ProjectedKey key;
+        key.score = team.score;
+        key.penalty_time = team.penalty_time;
+        key.solved_times = team.solved_times;
+        key.name = team.name;
+        key.id = id;
+        return key;
+    }
+
+    // A contender in one trial: its visible key plus the frozen problems
+    // the trial's draws solve. Drawing stops, returning false, once the
+    // score can no longer reach `cutoff`. Drawn solve times are sorted on
+    // their own and merged in once, rather than inserted one by one.
+    bool project_team(ProjectedKey& key, const ProjectedContender& contender,
+                      const std::vector<ProjectedDraw>& draws, int trial,
+                      const std::array<double, Width>& accept_rate, long long cutoff) const {
+        key = contender.base;
+        ProjectionRandom random(trial, key.id);
+        std::array<int, Width> drawn_times;
+        int drawn = 0;
+        for (int i = contender.first_draw; i < contender.last_draw; i++) {
+            const ProjectedDraw& draw = draws[i];
+            if (key.score + draw.score_left < cutoff) return false;
+            ProjectedProblem outcome = project_problem(random, draw.tries, accept_rate[draw.problem],
+                                                       freeze_time, latest_time);
+            if (outcome.solved_time < 0) continue;
+            key.score += rules.problem_score(draw.problem);
+            key.penalty_time +=
+                rules.problem_penalty(draw.wrong_before + outcome.wrong, outcome.solved_time);
+            if constexpr (Rules::kSolveTimeTiebreak) {
+                int j = drawn++;
+                for (; j > 0 && drawn_times[j - 1] < outcome.solved_time; j--) {
+                    drawn_times[j] = drawn_times[j - 1];
+                }
+                drawn_times[j] = outcome.solved_time;
+            }
+        }
+        if constexpr (Rules::kSolveTimeTiebreak) {
+            if (drawn == 0) return true;
+            // Both lists are largest first; merge from the back.
+            const std::array<int, Width>& visible = contender.base.solved_times;
+            int v = contender.visible_solved - 1;
+            int d = drawn - 1;
+            for (int out = contender.visible_solved + drawn - 1; d >= 0; out--) {
+                if (v >= 0 && visible[v] > drawn_times[d]) {
+                    key.solved_times[out] = drawn_times[d--];
+                } else if (v >= 0) {
+                    key.solved_times[out] = visible[v--];
+                } else {
+                    key.solved_times[out] = drawn_times[d--];
+                }
+            }
+        }
+        return true;
+    }
+
+    // `wrong` counts every rejected try, visible or drawn.
+    void add_solve(ProjectedKey& key, int prob_index, int wrong, int time) const {
+        key.score += rules.problem_score(prob_index);
+        key.penalty_time += rules.problem_penalty(wrong, time);
+        if constexpr (Rules::kSolveTimeTiebreak) {
+            // Keep the largest-first order; zero padding sorts last.
+            int i = Width - 1;
+            for (; i > 0 && key.solved_times[i - 1] < time; i--) {
+                key.solved_times[i] = key.solved_times[i - 1];
+            }
+            key.solved_times[i] = time;
+        }
+    }
+
+    void print_scoreboard() {
+        TraceSpan span("scoreboard.render");
+        int rank = 1;
+        for (int id : scoreboard) {
+            const TeamType& team = team_list[id];
+            out << team.name << " " << rank << " "
+                << team.score << " " << team.penalty_time;
+
+            for (int i = 0; i < problem_count; i++) {
+                const ProblemStatus& status = team.problems[i];
+                if (status.is_frozen()) {
+                    if (status.wrong_before == 0) {
+                        out << " 0/" << status.submissions_after_freeze;
+                    } else {
+                        out << " -" << status.wrong_before << "/" << status.submissions_after_freeze;
+                    }
+                } else if (status.solved()) {
+                    if (status.wrong_before == 0) {
+                        out << " +";
+                    } else {
+                        out << " +" << status.wrong_before;
+                    }
+                } else {
+                    if (status.wrong_before == 0) {
+                        out << " .";
+                    } else {
+                        out << " -" << status.wrong_before;
+                    }
+                }
+            }
+            out << "\n";
+            rank++;
+        }
+    }
+};
@@ -0,0 +1,58 @@
+#include "huge_page_arena.hpp"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+namespace {
+
+std::size_t round_up(std::size_t value, std::size_t step) { return (value + step - 1) / step * step; }
+
+}  // namespace
+
+HugePageArena::HugePageArena(std::size_t region_size)
+    : min_region_size(round_up(region_size, kHugePageSize)) {}
+
+HugePageArena::~HugePageArena() {
+    for (const Region& region : regions) {
+        munmap(region.base, region.size);
+    }
+}
+
+void* HugePageArena::do_allocate(std::size_t bytes, std::size_t alignment) {
+    auto aligned = [&] {
+        auto address = reinterpret_cast<std::uintptr_t>(cursor);
+        return reinterpret_cast<char*>(round_up(address, alignment));
+    };
+    if (!cursor || aligned() + bytes > limit) {
+        map_region(bytes + alignment);
+    }
+    char* p = aligned();
+    cursor = p + bytes;
+    return p;
+}
+
+void HugePageArena::map_region(std::size_t at_least) {
+    std::size_t size = round_up(std::max(at_least, min_region_size), kHugePageSize);
+    // Map one huge page extra and trim, so the region starts on a huge
+    // page boundary and every 2 MiB of it can become a huge page.
+    std::size_t reserved = size + kHugePageSize;
+    void* mapping = mmap(nullptr, reserved, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping == MAP_FAILED) throw std::bad_alloc();
+
+    char* raw = static_cast<char*>(mapping);
+    char* base = reinterpret_cast<char*>(round_up(reinterpret_cast<std::uintptr_t>(raw), kHugePageSize));
+    if (base > raw) munmap(raw, base - raw);
+    char* end = base + size;
+    if (raw + reserved > end) munmap(end, raw + reserved - end);
+
+#ifdef MADV_HUGEPAGE
+    madvise(base, size, MADV_HUGEPAGE);
+#endif
+    regions.push_back({base, size});
+    cursor = base;
+    limit = end;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+// Bump allocator over large anonymous mappings that are aligned to 2 MiB
+// and marked MADV_HUGEPAGE, so transparent huge pages can back them and a
+// few TLB entries cover all team and history data. Memory is only
+// returned when the arena is destroyed. Where THP is unavailable the
+// regions are ordinary pages and everything still works.
+class HugePageArena : public std::pmr::memory_resource {
+public:
+    static constexpr std::size_t kHugePageSize = std::size_t(2) << 20;
+
+    // Regions are at least `region_size` bytes, rounded up to huge pages.
+    explicit HugePageArena(std::size_t region_size = std::size_t(64) << 20);
+    ~HugePageArena() override;
+
+    HugePageArena(const HugePageArena&) = delete;
+    HugePageArena& operator=(const HugePageArena&) = delete;
+
+private:
+    struct Region {
+        char* base;
+        std::size_t size;
+    };
+
+    std::size_t min_region_size;
+    std::vector<Region> regions;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    void map_region(std::size_t at_least);
+};
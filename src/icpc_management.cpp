@@ -0,0 +1,111 @@
+#include "icpc_management.hpp"
+
+#include "contest_engine.hpp"
+#include "metrics.hpp"
+#include "rules.hpp"
+
+namespace {
+
+template <int Width, class Rules>
+std::unique_ptr<Contest> make_width(const Rules& rules, const ContestOptions& options,
+                                    const std::vector<std::string>& roster, int duration,
+                                    int problem_count, std::ostream& out) {
+    return std::make_unique<ContestEngine<Width, Rules>>(roster, duration, problem_count, rules,
+                                                         options, out);
+}
+
+template <class Rules>
+std::unique_ptr<Contest> make_engine(const Rules& rules, const ContestOptions& options,
+                                     const std::vector<std::string>& roster, int duration,
+                                     int problem_count, std::ostream& out) {
+    if (problem_count <= 8) {
+        return make_width<8>(rules, options, roster, duration, problem_count, out);
+    }
+    if (problem_count <= 16) {
+        return make_width<16>(rules, options, roster, duration, problem_count, out);
+    }
+    if (problem_count <= 26) {
+        return make_width<26>(rules, options, roster, duration, problem_count, out);
+    }
+    if (problem_count <= 32) {
+        return make_width<32>(rules, options, roster, duration, problem_count, out);
+    }
+    return make_width<kMaxProblems>(rules, options, roster, duration, problem_count, out);
+}
+
+}  // namespace
+
+std::unique_ptr<Contest> make_contest(const ContestOptions& options,
+                                      const std::vector<std::string>& roster, int duration,
+                                      int problem_count, std::ostream& out) {
+    switch (options.rules) {
+    case RulesKind::ShortPenalty:
+        return make_engine(ShortPenaltyRules(), options, roster, duration, problem_count, out);
+    case RulesKind::Untimed:
+        return make_engine(UntimedRules(), options, roster, duration, problem_count, out);
+    case RulesKind::Weighted:
+        return make_engine(WeightedRules{options.weights}, options, roster, duration,
+                           problem_count, out);
+    case RulesKind::Icpc:
+        break;
+    }
+    return make_engine(IcpcRules(), options, roster, duration, problem_count, out);
+}
+
+void ICPCManagement::add_team(const std::string& team_name) {
+    if (contest) {
+        out << "[Error]Add failed: competition has started.\n";
+        return;
+    }
+    if (!team_names.insert(team_name).second) {
+        out << "[Error]Add failed: duplicated team name.\n";
+        return;
+    }
+    roster.push_back(team_name);
+    out << "[Info]Add successfully.\n";
+}
+
+void ICPCManagement::start_competition(int duration, int problems) {
+    if (contest) {
+        out << "[Error]Start failed: competition has started.\n";
+        return;
+    }
+    contest = factory(options, roster, duration, problems, out);
+    if (options.reorder_window > 0) {
+        reorder = std::make_unique<ReorderBuffer>(options.reorder_window);
+    }
+
+    team_names.clear();
+    roster.clear();
+    roster.shrink_to_fit();
+    out << "[Info]Competition starts.\n";
+}
+
+void ICPCManagement::submit(const std::string& problem, const std::string& team_name,
+                            const std::string& status, int time, long long submission_id) {
+    if (!contest) return;
+    if (submission_id >= 0) {
+        if (!submission_ids.insert(static_cast<std::uint64_t>(submission_id))) {
+            Metrics::add(Metrics::global().duplicate_submissions, 1);
+            return;
+        }
+        Metrics::set(Metrics::global().submission_ids, submission_ids.size());
+        Metrics::set(Metrics::global().submission_id_bytes, submission_ids.bytes());
+    }
+    if (!reorder) {
+        contest->submit(problem, team_name, status, time);
+        return;
+    }
+    bool late = reorder->push({problem, team_name, status, time},
+                              [this](const PendingSubmission& next) { release(next); });
+    if (late) Metrics::add(Metrics::global().late_submissions, 1);
+    Metrics::set(Metrics::global().reorder_held, reorder->size());
+}
+
+Contest* ICPCManagement::ready() {
+    if (reorder) {
+        reorder->drain([this](const PendingSubmission& next) { release(next); });
+        Metrics::set(Metrics::global().reorder_held, 0);
+    }
+    return contest.get();
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "contest.hpp"
+#include "options.hpp"
+#include "reorder_buffer.hpp"
+#include "submission_id_set.hpp"
+
+// Builds the engine at START.
+using ContestFactory = std::unique_ptr<Contest> (*)(const ContestOptions& options,
+                                                   const std::vector<std::string>& roster,
+                                                   int duration, int problem_count,
+                                                   std::ostream& out);
+
+// Picks the engine instantiation for the configured rules and the
+// narrowest width class that fits problem_count.
+std::unique_ptr<Contest> make_contest(const ContestOptions& options,
+                                      const std::vector<std::string>& roster, int duration,
+                                      int problem_count, std::ostream& out);
+
+// Front end of the system. Teams are collected until START, which fixes
+// the problem count and instantiates the matching engine once; every
+// later command goes straight to that engine.
+class ICPCManagement {
+public:
+    explicit ICPCManagement(const ContestOptions& contest_options = ContestOptions(),
+                            std::ostream& output = std::cout,
+                            ContestFactory contest_factory = make_contest)
+        : options(contest_options), out(output), factory(contest_factory) {}
+
+    void add_team(const std::string& team_name);
+    void start_competition(int duration, int problems);
+
+    // A non-negative submission_id that was seen before marks a redelivery,
+    // which is dropped without output. With a reorder window, the engine
+    // gets the submission once the window has passed it.
+    void submit(const std::string& problem, const std::string& team_name,
+                const std::string& status, int time, long long submission_id = -1);
+    void flush_scoreboard() {
+        if (Contest* engine = ready()) engine->flush_scoreboard();
+    }
+    void freeze_scoreboard() {
+        if (Contest* engine = ready()) engine->freeze_scoreboard();
+    }
+    void scroll_scoreboard() {
+        if (Contest* engine = ready()) engine->scroll_scoreboard();
+    }
+    void query_ranking(const std::string& team_name) {
+        if (Contest* engine = ready()) engine->query_ranking(team_name);
+    }
+    void query_submission(const std::string& team_name, const std::string& problem,
+                          const std::string& status) {
+        if (Contest* engine = ready()) engine->query_submission(team_name, problem, status);
+    }
+    void query_submissions(const std::string& team_name, int from_time, int to_time,
+                           const std::string& problem, const std::string& status) {
+        if (Contest* engine = ready()) {
+            engine->query_submissions(team_name, from_time, to_time, problem, status);
+        }
+    }
+    void query_problems() {
+        if (Contest* engine = ready()) engine->query_problems();
+    }
+    void watch_team(const std::string& team_name) {
+        if (Contest* engine = ready()) engine->watch_team(team_name);
+    }
+    void unwatch_team(const std::string& team_name) {
+        if (Contest* engine = ready()) engine->unwatch_team(team_name);
+    }
+    void end_competition() {
+        if (Contest* engine = ready()) engine->end_competition();
+    }
+    void query_memory() {
+        if (Contest* engine = ready()) engine->query_memory();
+    }
+    void query_projection(int top, int trials) {
+        if (Contest* engine = ready()) engine->query_projection(top, trials);
+    }
+
+    // Before START, only the roster size is known.
+    ContestShape shape(const std::string& team_name) const {
+        if (contest) return contest->shape(team_name);
+        ContestShape result;
+        result.teams = static_cast<long long>(roster.size());
+        return result;
+    }
+
+private:
+    // The engine, once every held submission has reached it; null before
+    // START.
+    Contest* ready();
+    void release(const PendingSubmission& submission) {
+        contest->submit(submission.problem, submission.team_name, submission.status,
+                        submission.time);
+    }
+
+    ContestOptions options;
+    std::ostream& out;
+    ContestFactory factory;
+    std::unordered_set<std::string> team_names;
+    std::vector<std::string> roster;
+    std::unique_ptr<Contest> contest;
+    SubmissionIdSet submission_ids;
+    std::unique_ptr<ReorderBuffer> reorder;
+};
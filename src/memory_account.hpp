@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+// Live bytes, high-water mark and allocation count of one subsystem, and
+// the memory resource its allocations come from. Charges are forwarded to
+// `total`, if set, so a group of accounts also has a combined peak.
+struct MemoryAccount {
+    long long bytes = 0;
+    long long peak_bytes = 0;
+    long long allocations = 0;
+    MemoryAccount* total = nullptr;
+    std::pmr::memory_resource* resource = std::pmr::new_delete_resource();
+
+    void charge(long long size) {
+        bytes += size;
+        peak_bytes = std::max(peak_bytes, bytes);
+        allocations++;
+        if (total) total->charge(size);
+    }
+    void release(long long size) {
+        bytes -= size;
+        if (total) total->release(size);
+    }
+};
+
+// Allocates from an account's memory resource and charges the bytes to it.
+// Containers sharing an account compare equal, so swaps between them are
+// fine.
+template <class T>
+class CountingAllocator {
+public:
+    using value_type = T;
+
+    explicit CountingAllocator(MemoryAccount* memory_account) noexcept : account(memory_account) {}
+    template <class U>
+    CountingAllocator(const CountingAllocator<U>& other) noexcept : account(other.account) {}
+
+    T* allocate(std::size_t n) {
+        T* p = static_cast<T*>(account->resource->allocate(n * sizeof(T), alignof(T)));
+        account->charge(static_cast<long long>(n * sizeof(T)));
+        return p;
+    }
+    void deallocate(T* p, std::size_t n) {
+        account->release(static_cast<long long>(n * sizeof(T)));
+        account->resource->deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    template <class U>
+    bool operator==(const CountingAllocator<U>& other) const { return account == other.account; }
+    template <class U>
+    bool operator!=(const CountingAllocator<U>& other) const { return account != other.account; }
+
+    MemoryAccount* account;
+};
+
+template <class T>
+using CountedVector = std::vector<T, CountingAllocator<T>>;
+
+using CountedString = std::basic_string<char, std::char_traits<char>, CountingAllocator<char>>;
+
+// The parts of an engine whose memory QUERY_MEMORY reports separately.
+enum class MemorySubsystem {
+    Teams,      // team records, including names too long to store inline
+    NameIndex,  // the name -> id hash map
+    History,    // submission history or last-submission cells
+    Ranking,    // flushed scoreboard, rank and dirty arrays, watch lists
+    Scroll,     // ordered sets that exist only while SCROLL runs
+};
+
+constexpr int kMemorySubsystemCount = static_cast<int>(MemorySubsystem::Scroll) + 1;
+
+inline const char* memory_subsystem_name(MemorySubsystem subsystem) {
+    static const char* const names[kMemorySubsystemCount] = {"teams", "name_index", "history",
+                                                             "ranking", "scroll"};
+    return names[static_cast<int>(subsystem)];
+}
+
+// One account per subsystem plus their sum. Containers keep pointers to
+// these, so the accounts must not move. Teams, the name index and the
+// history live until END and draw from `long_lived`; the ranking arrays
+// and scroll sets draw from `transient`.
+struct MemoryAccounts {
+    MemoryAccount total;
+    std::array<MemoryAccount, kMemorySubsystemCount> subsystems;
+
+    MemoryAccounts(std::pmr::memory_resource* long_lived = std::pmr::new_delete_resource(),
+                   std::pmr::memory_resource* transient = std::pmr::new_delete_resource()) {
+        for (int i = 0; i < kMemorySubsystemCount; i++) {
+            subsystems[i].total = &total;
+            bool lives_to_end = i <= static_cast<int>(MemorySubsystem::History);
+            subsystems[i].resource = lives_to_end ? long_lived : transient;
+        }
+    }
+    MemoryAccounts(const MemoryAccounts&) = delete;
+    MemoryAccounts& operator=(const MemoryAccounts&) = delete;
+
+    MemoryAccount* operator[](MemorySubsystem subsystem) {
+        return &subsystems[static_cast<int>(subsystem)];
+    }
+};
@@ -0,0 +1,115 @@
+#include "metrics.hpp"
+
+#include <pthread.h>
+#include <signal.h>
+
+#include <cstdio>
+
+#include "command.hpp"
+
+static_assert(kCommandTypeCount <= Metrics::kCommandSlots, "Metrics::kCommandSlots is too small");
+
+void Metrics::record_command(int type, double elapsed_us) {
+    add(commands[type], 1);
+    int bucket = 0;
+    while (bucket < kLatencyBuckets - 1 && elapsed_us > static_cast<double>(1ULL << bucket)) {
+        bucket++;
+    }
+    add(latency_buckets[type][bucket], 1);
+    add(latency_sum_us[type], static_cast<std::int64_t>(elapsed_us));
+}
+
+void Metrics::write(std::FILE* file) const {
+    auto get = [](const Counter& counter) {
+        return static_cast<unsigned long long>(counter.load(std::memory_order_relaxed));
+    };
+
+    std::fprintf(file, "# TYPE icpc_commands_total counter\n");
+    for (int i = 0; i < kCommandTypeCount; i++) {
+        std::fprintf(file, "icpc_commands_total{command=\"%s\"} %llu\n",
+                     command_name(static_cast<CommandType>(i)), get(commands[i]));
+    }
+    std::fprintf(file, "# TYPE icpc_flushes_total counter\nicpc_flushes_total %llu\n", get(flushes));
+    std::fprintf(file, "# TYPE icpc_scroll_steps_total counter\nicpc_scroll_steps_total %llu\n",
+                 get(scroll_steps));
+    std::fprintf(file, "# TYPE icpc_submissions_total counter\nicpc_submissions_total %llu\n",
+                 get(submissions));
+    std::fprintf(file, "# TYPE icpc_duplicate_submissions_total counter\n"
+                       "icpc_duplicate_submissions_total %llu\n",
+                 get(duplicate_submissions));
+    std::fprintf(file, "# TYPE icpc_late_submissions_total counter\nicpc_late_submissions_total %llu\n",
+                 get(late_submissions));
+    std::fprintf(file, "# TYPE icpc_teams_with_frozen_problems gauge\n"
+                       "icpc_teams_with_frozen_problems %llu\n",
+                 get(teams_with_frozen_problems));
+    std::fprintf(file, "# TYPE icpc_frozen_problems gauge\nicpc_frozen_problems %llu\n",
+                 get(frozen_problems));
+    std::fprintf(file, "# TYPE icpc_submission_ids gauge\nicpc_submission_ids %llu\n",
+                 get(submission_ids));
+    std::fprintf(file, "# TYPE icpc_submission_id_bytes gauge\nicpc_submission_id_bytes %llu\n",
+                 get(submission_id_bytes));
+    std::fprintf(file, "# TYPE icpc_reorder_held gauge\nicpc_reorder_held %llu\n", get(reorder_held));
+
+    // Only command types with latency samples; main records them only
+    // while a dumper is running.
+    std::fprintf(file, "# TYPE icpc_command_latency_us histogram\n");
+    for (int i = 0; i < kCommandTypeCount; i++) {
+        const char* name = command_name(static_cast<CommandType>(i));
+        unsigned long long cumulative = 0;
+        for (int bucket = 0; bucket < kLatencyBuckets; bucket++) {
+            cumulative += get(latency_buckets[i][bucket]);
+        }
+        if (cumulative == 0) continue;
+
+        cumulative = 0;
+        for (int bucket = 0; bucket < kLatencyBuckets - 1; bucket++) {
+            cumulative += get(latency_buckets[i][bucket]);
+            std::fprintf(file, "icpc_command_latency_us_bucket{command=\"%s\",le=\"%llu\"} %llu\n",
+                         name, 1ULL << bucket, cumulative);
+        }
+        cumulative += get(latency_buckets[i][kLatencyBuckets - 1]);
+        std::fprintf(file, "icpc_command_latency_us_bucket{command=\"%s\",le=\"+Inf\"} %llu\n", name,
+                     cumulative);
+        std::fprintf(file, "icpc_command_latency_us_sum{command=\"%s\"} %llu\n", name,
+                     get(latency_sum_us[i]));
+        std::fprintf(file, "icpc_command_latency_us_count{command=\"%s\"} %llu\n", name, cumulative);
+    }
+}
+
+MetricsDumper::MetricsDumper(const std::string& dump_path) : path(dump_path) {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    worker = std::thread(&MetricsDumper::run, this);
+}
+
+MetricsDumper::~MetricsDumper() {
+    stopping.store(true);
+    pthread_kill(worker.native_handle(), SIGUSR1);
+    worker.join();
+}
+
+void MetricsDumper::run() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    while (true) {
+        int signal = 0;
+        if (sigwait(&signals, &signal) != 0) continue;
+        if (stopping.load()) return;
+        dump();
+    }
+}
+
+// Written to a temporary file and renamed, so readers never see a
+// partial snapshot.
+void MetricsDumper::dump() const {
+    std::string temporary = path + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "w");
+    if (!file) return;
+    Metrics::global().write(file);
+    if (std::fclose(file) == 0) {
+        std::rename(temporary.c_str(), path.c_str());
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+// Process-wide counters for operators, readable while a contest runs.
+// Only the command thread writes them, so an update is a relaxed load and
+// store rather than a locked read-modify-write; the dump thread reads
+// them relaxed. A snapshot may therefore mix values from neighbouring
+// commands, but never tears a single value.
+struct Metrics {
+    using Counter = std::atomic<std::uint64_t>;
+
+    // Enough for every CommandType; checked in metrics.cpp.
+    static constexpr int kCommandSlots = 16;
+    // Latency buckets with upper bounds of 1, 2, 4, ... microseconds; the
+    // last bucket has no bound.
+    static constexpr int kLatencyBuckets = 24;
+
+    Counter commands[kCommandSlots] = {};
+    Counter latency_buckets[kCommandSlots][kLatencyBuckets] = {};
+    Counter latency_sum_us[kCommandSlots] = {};
+    Counter flushes{0};
+    Counter scroll_steps{0};
+    Counter submissions{0};
+    // SUBMITs dropped because their ID was already seen
+    Counter duplicate_submissions{0};
+    // SUBMITs that reached the engine after a later time despite the
+    // reorder window
+    Counter late_submissions{0};
+    // Gauges, maintained by the engine
+    Counter teams_with_frozen_problems{0};
+    Counter frozen_problems{0};
+    // Gauges, maintained by the front end: distinct submission ids seen
+    // and the bytes of the set holding them
+    Counter submission_ids{0};
+    Counter submission_id_bytes{0};
+    // SUBMITs the reorder window is holding back
+    Counter reorder_held{0};
+
+    static Metrics& global() {
+        static Metrics metrics;
+        return metrics;
+    }
+
+    static void add(Counter& counter, std::int64_t delta) {
+        counter.store(counter.load(std::memory_order_relaxed) + static_cast<std::uint64_t>(delta),
+                      std::memory_order_relaxed);
+    }
+
+    static void set(Counter& gauge, std::uint64_t value) { gauge.store(value, std::memory_order_relaxed); }
+
+    void record_command(int type, double elapsed_us);
+    // Writes a snapshot in the Prometheus text exposition format.
+    void write(std::FILE* file) const;
+};
+
+// Writes a Metrics::global() snapshot to a file whenever the process gets
+// SIGUSR1. The signal is blocked in every thread and collected by a
+// sigwait thread, so nothing runs in signal context and the command
+// thread is never interrupted. The constructor blocks the signal and
+// starts that thread, so the dumper must be constructed before any other
+// thread is created; they all inherit the blocked mask.
+class MetricsDumper {
+public:
+    explicit MetricsDumper(const std::string& path);
+    ~MetricsDumper();
+
+    MetricsDumper(const MetricsDumper&) = delete;
+    MetricsDumper& operator=(const MetricsDumper&) = delete;
+
+private:
+    std::string path;
+    std::atomic<bool> stopping{false};
+    std::thread worker;
+
+    void run();
+    void dump() const;
+};
@@ -0,0 +1,145 @@
+#include "options.hpp"
+
+#include <sstream>
+
+namespace {
+
+bool parse_positive(const std::string& text, long long& value) {
+    try {
+        size_t used = 0;
+        value = std::stoll(text, &used);
+        return used == text.size() && value > 0;
+    } catch (...) {
+        return false;
+    }
+}
+
+bool parse_int_list(const std::string& text, std::vector<int>& values) {
+    values.clear();
+    std::istringstream iss(text);
+    std::string item;
+    while (std::getline(iss, item, ',')) {
+        try {
+            values.push_back(std::stoi(item));
+        } catch (...) {
+            return false;
+        }
+    }
+    return !values.empty();
+}
+
+}  // namespace
+
+bool parse_option(const std::string& arg, ContestOptions& options) {
+    size_t eq = arg.find('=');
+    std::string name = arg.substr(0, eq);
+    std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+    if (name == "--rules") {
+        if (value == "icpc") {
+            options.rules = RulesKind::Icpc;
+        } else if (value == "icpc-10") {
+            options.rules = RulesKind::ShortPenalty;
+        } else if (value == "untimed") {
+            options.rules = RulesKind::Untimed;
+        } else if (value == "weighted") {
+            options.rules = RulesKind::Weighted;
+        } else {
+            return false;
+        }
+        return true;
+    }
+    if (name == "--allocator") {
+        if (value == "heap") {
+            options.allocator = AllocatorKind::Heap;
+        } else if (value == "arena") {
+            options.allocator = AllocatorKind::Arena;
+        } else if (value == "hugepage") {
+            options.allocator = AllocatorKind::HugePages;
+        } else {
+            return false;
+        }
+        return true;
+    }
+    if (name == "--output") {
+        if (value == "stream") {
+            options.output = OutputKind::Stream;
+        } else if (value == "uring") {
+            options.output = OutputKind::Uring;
+        } else {
+            return false;
+        }
+        return true;
+    }
+    if (name == "--weights") {
+        return parse_int_list(value, options.weights);
+    }
+    if (arg == "--no-history") {
+        options.keep_history = false;
+        return true;
+    }
+    if (name == "--input" && !value.empty()) {
+        options.input_file = value;
+        return true;
+    }
+    if (name == "--trace" && !value.empty()) {
+        options.trace_file = value;
+        return true;
+    }
+    if (name == "--metrics-file" && !value.empty()) {
+        options.metrics_file = value;
+        return true;
+    }
+    if (name == "--slow-log" && !value.empty()) {
+        options.slow_log_file = value;
+        return true;
+    }
+    long long number = 0;
+    if (name == "--slow-threshold-ms" && parse_positive(value, number)) {
+        options.slow_threshold_ms = number;
+        return true;
+    }
+    if (name == "--projection-threads" && parse_positive(value, number)) {
+        options.projection_threads = static_cast<int>(number);
+        return true;
+    }
+    if (name == "--reorder-window" && parse_positive(value, number)) {
+        options.reorder_window = static_cast<int>(number);
+        return true;
+    }
+    if (name == "--auto-flush-submissions" && parse_positive(value, number)) {
+        options.auto_flush.submissions = number;
+        return true;
+    }
+    if (name == "--auto-flush-interval" && parse_positive(value, number)) {
+        options.auto_flush.interval = static_cast<int>(number);
+        return true;
+    }
+    if (name == "--auto-flush-top" && parse_positive(value, number)) {
+        options.auto_flush.top = static_cast<int>(number);
+        return true;
+    }
+    return false;
+}
+
+bool options_consistent(const ContestOptions& options) {
+    return options.weights.empty() || options.rules == RulesKind::Weighted;
+}
+
+const char* option_help() {
+    return "  --rules=icpc|icpc-10|untimed|weighted  ranking rules (default icpc)\n"
+           "  --weights=W1,W2,...                    problem weights for --rules=weighted\n"
+           "  --no-history                           keep only last-submission summaries\n"
+           "  --allocator=heap|arena|hugepage        engine memory strategy (default heap)\n"
+           "  --output=stream|uring                  stdout writer (default stream)\n"
+           "  --projection-threads=N                 QUERY_PROJECTION threads (default one per core)\n"
+           "  --reorder-window=T                     put SUBMITs up to T time units late in order\n"
+           "  --auto-flush-submissions=K             flush after K visible submissions\n"
+           "  --auto-flush-interval=T                flush after T units of contest time\n"
+           "  --auto-flush-top=K                     flush when the top K may have changed\n"
+           "  --input=FILE                           read commands from FILE instead of stdin\n"
+           "  --trace=FILE                           write Chrome trace events to FILE\n"
+           "  --slow-log=FILE                        append slow commands with state to FILE\n"
+           "  --slow-threshold-ms=MS                 slow-log threshold (default 100)\n"
+           "  --metrics-file=FILE                    write a metrics snapshot to FILE on SIGUSR1\n";
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+enum class RulesKind {
+    Icpc,
+    ShortPenalty,
+    Untimed,
+    Weighted,
+};
+
+// Where the engine's containers get their memory.
+enum class AllocatorKind {
+    // Global operator new and delete.
+    Heap,
+    // A monotonic arena for teams, names and history, which are only
+    // released at exit, and a pool that recycles blocks for the ranking
+    // arrays and scroll sets.
+    Arena,
+    // As Arena, but the long-lived data sits in 2 MiB-aligned regions
+    // advised for transparent huge pages.
+    HugePages,
+};
+
+// How output reaches stdout.
+enum class OutputKind {
+    // std::cout's own buffer, written synchronously.
+    Stream,
+    // Two 1 MiB chunks handed to io_uring in turn, falling back to write.
+    Uring,
+};
+
+// When the engine flushes on its own. A flush is due once any enabled
+// trigger fires; zero disables a trigger.
+struct AutoFlushPolicy {
+    // Visible submissions since the last flush.
+    long long submissions = 0;
+    // Contest time elapsed since the last flush.
+    int interval = 0;
+    // A visible change that may reorder the first `top` places.
+    int top = 0;
+
+    bool enabled() const { return submissions > 0 || interval > 0 || top > 0; }
+};
+
+// Settings taken from the command line. The defaults reproduce the plain
+// ICPC contest described in the README.
+struct ContestOptions {
+    RulesKind rules = RulesKind::Icpc;
+    std::vector<int> weights;
+    // Without history only the last submission per (problem, status) is
+    // kept for each team, which is all QUERY_SUBMISSION needs.
+    bool keep_history = true;
+    AutoFlushPolicy auto_flush;
+    // Contest time SUBMITs are held to put them in time order; zero
+    // passes them straight to the engine.
+    int reorder_window = 0;
+    AllocatorKind allocator = AllocatorKind::Heap;
+    OutputKind output = OutputKind::Stream;
+    // Worker threads for QUERY_PROJECTION; zero for one per core.
+    int projection_threads = 0;
+    // Chrome trace-event file for command and engine spans; empty for none.
+    std::string trace_file;
+    // Log of commands taking at least slow_threshold_ms; empty for none.
+    std::string slow_log_file;
+    long long slow_threshold_ms = 100;
+    // Command file to read instead of stdin; empty for stdin.
+    std::string input_file;
+    // Where SIGUSR1 writes a metrics snapshot; empty to leave SIGUSR1 alone.
+    std::string metrics_file;
+};
+
+// Applies one "--name=value" argument. Returns false if it is not recognised.
+bool parse_option(const std::string& arg, ContestOptions& options);
+
+// Checks the options as a whole once every argument is parsed. Returns
+// false for combinations that would be silently ignored, such as
+// --weights without --rules=weighted.
+bool options_consistent(const ContestOptions& options);
+
+// One line per option, for the usage message.
+const char* option_help();
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+
+constexpr int kMaxProblems = 64;
+
+// Problems are named like spreadsheet columns: A..Z, then AA..AZ, BA..,
+// so the first 26 keep their single-letter names. Returns -1 for anything
+// that is not a valid name.
+inline int problem_index(const std::string& name) {
+    if (name.size() == 1) {
+        int index = name[0] - 'A';
+        return index >= 0 && index < 26 ? index : -1;
+    }
+    if (name.empty() || name.size() > 2) return -1;
+
+    int index = 0;
+    for (char c : name) {
+        if (c < 'A' || c > 'Z') return -1;
+        index = index * 26 + (c - 'A' + 1);
+    }
+    return index - 1;
+}
+
+inline std::string problem_name(int index) {
+    std::string name;
+    for (index++; index > 0; index = (index - 1) / 26) {
+        name.insert(name.begin(), static_cast<char>('A' + (index - 1) % 26));
+    }
+    return name;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string_view>
+
+// Shared by every engine's QUERY_PROJECTION, so that they draw the same
+// outcomes and agree on the output. The model only uses what a frozen
+// board shows: how many tries each team has pending on each problem.
+//
+// Every try on problem j is accepted with the problem's visible rate,
+// (accepted + 1) / (tries + 2) over all submissions the board shows. The
+// first accepted try solves the problem, after the tries before it
+// counted as wrong, at a time drawn uniformly from [freeze time, latest
+// submission time]. Contest time starts at 1, which also keeps drawn
+// times clear of the zero padding in solve-time lists.
+
+constexpr int kDefaultProjectionTrials = 1000;
+constexpr int kMaxProjectionTrials = 1000000;
+
+inline double projection_accept_rate(long long accepted, long long tries) {
+    return (accepted + 1.0) / (tries + 2.0);
+}
+
+// splitmix64, handed out 32 bits at a time. Each (trial, team) pair gets
+// its own stream, so outcomes do not depend on which thread runs a trial
+// or on which teams an engine stops drawing for. `team` is the team's
+// position among all teams in name order.
+class ProjectionRandom {
+public:
+    ProjectionRandom(int trial, int team)
+        : state((static_cast<std::uint64_t>(trial) << 32 | static_cast<std::uint32_t>(team)) *
+                0x9e3779b97f4a7c15ULL) {}
+
+    std::uint32_t next() {
+        if (has_spare) {
+            has_spare = false;
+            return spare;
+        }
+        std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        z ^= z >> 31;
+        spare = static_cast<std::uint32_t>(z >> 32);
+        has_spare = true;
+        return static_cast<std::uint32_t>(z);
+    }
+
+private:
+    std::uint64_t state;
+    std::uint32_t spare = 0;
+    bool has_spare = false;
+};
+
+// One drawn outcome for a frozen problem.
+struct ProjectedProblem {
+    int wrong = 0;
+    // -1 if no pending try was accepted.
+    int solved_time = -1;
+};
+
+inline int earliest_projected_solve(int freeze_time) { return freeze_time > 1 ? freeze_time : 1; }
+
+inline ProjectedProblem project_problem(ProjectionRandom& random, int tries, double accept_rate,
+                                        int freeze_time, int latest_time) {
+    ProjectedProblem result;
+    // A try is accepted if a 32-bit draw falls below rate * 2^32; the rate
+    // is always below 1.
+    auto threshold = static_cast<std::uint32_t>(accept_rate * 4294967296.0);
+    for (int i = 0; i < tries; i++) {
+        if (random.next() < threshold) {
+            int earliest = earliest_projected_solve(freeze_time);
+            std::uint64_t span = latest_time > earliest ? latest_time - earliest + 1 : 1;
+            result.solved_time = earliest + static_cast<int>(random.next() * span >> 32);
+            return result;
+        }
+        result.wrong++;
+    }
+    return result;
+}
+
+inline void print_projection(std::ostream& out, std::string_view team_name, long long hits,
+                             int trials) {
+    char probability[32];
+    std::snprintf(probability, sizeof(probability), "%.4f", static_cast<double>(hits) / trials);
+    out << "[" << team_name << "] [" << probability << "]\n";
+}
@@ -0,0 +1,23 @@
+#include "reference_engine.hpp"
+
+#include "rules.hpp"
+
+std::unique_ptr<Contest> make_reference_contest(const ContestOptions& options,
+                                                const std::vector<std::string>& roster,
+                                                int duration, int problem_count, std::ostream& out) {
+    switch (options.rules) {
+    case RulesKind::ShortPenalty:
+        return std::make_unique<ReferenceEngine<ShortPenaltyRules>>(
+            roster, duration, problem_count, ShortPenaltyRules(), options, out);
+    case RulesKind::Untimed:
+        return std::make_unique<ReferenceEngine<UntimedRules>>(roster, duration, problem_count,
+                                                               UntimedRules(), options, out);
+    case RulesKind::Weighted:
+        return std::make_unique<ReferenceEngine<WeightedRules>>(
+            roster, duration, problem_count, WeightedRules{options.weights}, options, out);
+    case RulesKind::Icpc:
+        break;
+    }
+    return std::make_unique<ReferenceEngine<IcpcRules>>(roster, duration, problem_count, IcpcRules(),
+                                                        options, out);
+}
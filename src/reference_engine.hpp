@@ -0,0 +1,581 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "contest.hpp"
+#include "options.hpp"
+#include "problem_id.hpp"
+#include "projection.hpp"
+#include "submission.hpp"
+
+// Straightforward implementation of every command, kept as the oracle that
+// optimised engines are diffed against (see tools/icpc_diff.cpp). It
+// rescores every team on each flush, re-sorts the whole board after every
+// unfreeze and answers queries by scanning. Keep it simple rather than
+// fast, and keep it independent of the optimised engine's bookkeeping.
+template <class Rules>
+class ReferenceEngine : public Contest {
+public:
+    ReferenceEngine(const std::vector<std::string>& roster, int duration, int problems,
+                    const Rules& contest_rules, const ContestOptions& options, std::ostream& output)
+        : out(output), rules(contest_rules), auto_flush(options.auto_flush),
+          keep_history(options.keep_history), duration_time(duration),
+          problem_count(std::min(problems, kMaxProblems)) {
+        for (const auto& name : roster) {
+            team_list.push_back(std::make_unique<Team>(name, problem_count));
+            teams[name] = team_list.back().get();
+        }
+        for (const auto& team : team_list) {
+            last_flushed_ranking.push_back(team.get());
+        }
+        std::sort(last_flushed_ranking.begin(), last_flushed_ranking.end(),
+                  [](const Team* a, const Team* b) { return a->name < b->name; });
+    }
+
+    void submit(const std::string& problem, const std::string& team_name,
+                const std::string& status, int time) override {
+        if (competition_ended) return;
+
+        if (flush_pending && time > pending_flush_time) {
+            flush_rankings();
+            report_watch_events();
+        }
+        latest_time = std::max(latest_time, time);
+
+        auto it = teams.find(team_name);
+        if (it == teams.end()) return;
+
+        Team* team = it->second;
+        int prob_index = problem_index(problem);
+        if (prob_index < 0 || prob_index >= problem_count) return;
+
+        SubmitStatus verdict;
+        if (!parse_status(status, verdict)) return;
+
+        int seq = ++submission_count;
+        team->submissions.push_back({prob_index, verdict, time, seq});
+        Problem& prob = team->problems[prob_index];
+        if (prob.solved) return;
+
+        if (is_frozen) {
+            if (!prob.is_frozen) {
+                prob.is_frozen = true;
+                prob.first_frozen_submission = static_cast<int>(team->submissions.size()) - 1;
+            }
+            prob.submissions_after_freeze++;
+            return;
+        }
+
+        bool accepted = verdict == SubmitStatus::Accepted;
+        if (accepted) {
+            prob.solved = true;
+            prob.solved_time = time;
+            prob.solved_seq = seq;
+        } else {
+            prob.wrong_before++;
+        }
+
+        if (auto_flush.enabled()) {
+            changes_since_flush++;
+            if (!flush_pending && auto_flush_due(team, accepted, time)) {
+                flush_pending = true;
+                pending_flush_time = time;
+            }
+        }
+    }
+
+    void flush_scoreboard() override {
+        if (competition_ended) return;
+
+        flush_rankings();
+        out << "[Info]Flush scoreboard.\n";
+        report_watch_events();
+    }
+
+    void freeze_scoreboard() override {
+        if (competition_ended) return;
+        settle_auto_flush();
+
+        if (is_frozen) {
+            out << "[Error]Freeze failed: scoreboard has been frozen.\n";
+            return;
+        }
+        is_frozen = true;
+        freeze_time = latest_time;
+        out << "[Info]Freeze scoreboard.\n";
+    }
+
+    void scroll_scoreboard() override {
+        if (competition_ended) return;
+        settle_auto_flush();
+
+        if (!is_frozen) {
+            out << "[Error]Scroll failed: scoreboard has not been frozen.\n";
+            return;
+        }
+
+        out << "[Info]Scroll scoreboard.\n";
+        // Watched teams get one line for the whole scroll, which replaces
+        // the ones the implicit flush noted.
+        std::vector<Team*> before_scroll = last_flushed_ranking;
+        flush_rankings();
+        watch_events.clear();
+        print_scoreboard(last_flushed_ranking);
+
+        std::vector<Team*> ranking = last_flushed_ranking;
+        while (true) {
+            Team* target_team = nullptr;
+            int target_problem = -1;
+            for (auto it = ranking.rbegin(); it != ranking.rend() && !target_team; ++it) {
+                for (int i = 0; i < problem_count; i++) {
+                    if ((*it)->problems[i].is_frozen) {
+                        target_team = *it;
+                        target_problem = i;
+                        break;
+                    }
+                }
+            }
+            if (!target_team) break;
+
+            bool solved = unfreeze(target_team, target_problem);
+            target_team->calculate_ranking(rules, problem_count);
+
+            std::vector<Team*> new_ranking = ranking;
+            std::sort(new_ranking.begin(), new_ranking.end(), Compare());
+
+            int old_rank = rank_in(ranking, target_team);
+            int new_rank = rank_in(new_ranking, target_team);
+            if (solved && new_rank < old_rank) {
+                out << target_team->name << " " << ranking[new_rank - 1]->name << " "
+                    << target_team->score << " " << target_team->penalty_time << "\n";
+            }
+
+            ranking.swap(new_ranking);
+        }
+
+        print_scoreboard(ranking);
+        for (Team* team : watched_teams) {
+            note_rank_change(team, before_scroll, ranking);
+        }
+        last_flushed_ranking = ranking;
+        report_watch_events();
+        is_frozen = false;
+    }
+
+    void query_ranking(const std::string& team_name) override {
+        settle_auto_flush();
+
+        auto it = teams.find(team_name);
+        if (it == teams.end()) {
+            out << "[Error]Query ranking failed: cannot find the team.\n";
+            return;
+        }
+
+        out << "[Info]Complete query ranking.\n";
+        if (is_frozen) {
+            out << "[Warning]Scoreboard is frozen. The ranking may be inaccurate until it were scrolled.\n";
+        }
+        out << "[" << team_name << "] NOW AT RANKING [" << rank_in(last_flushed_ranking, it->second)
+            << "]\n";
+    }
+
+    void query_submission(const std::string& team_name, const std::string& problem,
+                          const std::string& status) override {
+        auto it = teams.find(team_name);
+        if (it == teams.end()) {
+            out << "[Error]Query submission failed: cannot find the team.\n";
+            return;
+        }
+
+        out << "[Info]Complete query submission.\n";
+        const Submission* result = nullptr;
+        // The latest time wins, then the latest arrival.
+        for (const auto& sub : it->second->submissions) {
+            if (matches(sub, problem, status) && (!result || sub.time >= result->time)) result = &sub;
+        }
+        if (result == nullptr) {
+            out << "Cannot find any submission.\n";
+        } else {
+            print_submission(team_name, *result);
+        }
+    }
+
+    void query_submissions(const std::string& team_name, int from_time, int to_time,
+                           const std::string& problem, const std::string& status) override {
+        auto it = teams.find(team_name);
+        if (it == teams.end()) {
+            out << "[Error]Query submissions failed: cannot find the team.\n";
+            return;
+        }
+        if (!keep_history) {
+            out << "[Error]Query submissions failed: submission history is disabled.\n";
+            return;
+        }
+
+        out << "[Info]Complete query submissions.\n";
+        // In time order, equal times in arrival order.
+        std::vector<const Submission*> found;
+        for (const auto& sub : it->second->submissions) {
+            if (sub.time >= from_time && sub.time <= to_time && matches(sub, problem, status)) {
+                found.push_back(&sub);
+            }
+        }
+        std::stable_sort(found.begin(), found.end(),
+                         [](const Submission* a, const Submission* b) { return a->time < b->time; });
+        for (const Submission* sub : found) {
+            print_submission(team_name, *sub);
+        }
+        if (found.empty()) {
+            out << "Cannot find any submission.\n";
+        }
+    }
+
+    void query_problems() override {
+        out << "[Info]Complete query problems.\n";
+        for (int i = 0; i < problem_count; i++) {
+            int solved_teams = 0;
+            int attempted_teams = 0;
+            const Team* first = nullptr;
+            for (const auto& team : team_list) {
+                const Problem& prob = team->problems[i];
+                if (prob.solved || prob.wrong_before > 0) attempted_teams++;
+                if (!prob.solved) continue;
+
+                solved_teams++;
+                const Problem* best = first ? &first->problems[i] : nullptr;
+                if (!best || prob.solved_time < best->solved_time ||
+                    (prob.solved_time == best->solved_time && prob.solved_seq < best->solved_seq)) {
+                    first = team.get();
+                }
+            }
+
+            out << "[" << problem_name(i) << "] [" << solved_teams << "] [" << attempted_teams << "]";
+            if (first) {
+                out << " [" << first->name << "] [" << first->problems[i].solved_time << "]";
+            }
+            out << "\n";
+        }
+    }
+
+    void watch_team(const std::string& team_name) override {
+        auto it = teams.find(team_name);
+        if (it == teams.end()) {
+            out << "[Error]Watch failed: cannot find the team.\n";
+            return;
+        }
+        if (is_watched(it->second)) {
+            out << "[Error]Watch failed: team is already watched.\n";
+            return;
+        }
+        watched_teams.push_back(it->second);
+        out << "[Info]Watch successfully.\n";
+    }
+
+    void unwatch_team(const std::string& team_name) override {
+        auto it = teams.find(team_name);
+        if (it == teams.end() || !is_watched(it->second)) {
+            out << "[Error]Unwatch failed: team is not watched.\n";
+            return;
+        }
+        watched_teams.erase(std::find(watched_teams.begin(), watched_teams.end(), it->second));
+        out << "[Info]Unwatch successfully.\n";
+    }
+
+    void end_competition() override {
+        if (competition_ended) return;
+
+        competition_ended = true;
+        out << "[Info]Competition ends.\n";
+    }
+
+    void query_memory() override {
+        out << "[Error]Query memory failed: not tracked by the reference engine.\n";
+    }
+
+    // Plays every trial out in full: copies each team, applies its draws
+    // and sorts the whole board.
+    void query_projection(int top, int trials) override {
+        if (!is_frozen) {
+            out << "[Error]Query projection failed: scoreboard is not frozen.\n";
+            return;
+        }
+        if (top < 1 || trials < 1 || trials > kMaxProjectionTrials) {
+            out << "[Error]Query projection failed: invalid parameters.\n";
+            return;
+        }
+
+        std::vector<const Team*> by_name;
+        for (const auto& team : team_list) {
+            by_name.push_back(team.get());
+        }
+        std::sort(by_name.begin(), by_name.end(),
+                  [](const Team* a, const Team* b) { return a->name < b->name; });
+
+        std::vector<double> accept_rate(problem_count);
+        for (int j = 0; j < problem_count; j++) {
+            long long tries = 0;
+            long long accepted = 0;
+            for (const Team* team : by_name) {
+                tries += team->problems[j].wrong_before + team->problems[j].solved;
+                accepted += team->problems[j].solved;
+            }
+            accept_rate[j] = projection_accept_rate(accepted, tries);
+        }
+
+        std::vector<long long> hits(by_name.size());
+        for (int trial = 0; trial < trials; trial++) {
+            std::vector<Team> outcome;
+            for (size_t i = 0; i < by_name.size(); i++) {
+                outcome.emplace_back(by_name[i]->name, problem_count);
+                outcome.back().problems = by_name[i]->problems;
+                ProjectionRandom random(trial, static_cast<int>(i));
+                for (int j = 0; j < problem_count; j++) {
+                    Problem& prob = outcome.back().problems[j];
+                    if (!prob.is_frozen) continue;
+                    ProjectedProblem drawn = project_problem(random, prob.submissions_after_freeze,
+                                                             accept_rate[j], freeze_time, latest_time);
+                    if (drawn.solved_time >= 0) {
+                        prob.solved = true;
+                        prob.solved_time = drawn.solved_time;
+                        prob.wrong_before += drawn.wrong;
+                    }
+                }
+                outcome.back().calculate_ranking(rules, problem_count);
+            }
+            std::vector<Team*> ranking;
+            for (auto& team : outcome) {
+                ranking.push_back(&team);
+            }
+            std::sort(ranking.begin(), ranking.end(), Compare());
+            for (int place = 0; place < top && place < static_cast<int>(ranking.size()); place++) {
+                hits[ranking[place] - outcome.data()]++;
+            }
+        }
+
+        std::vector<size_t> order;
+        for (size_t i = 0; i < hits.size(); i++) {
+            if (hits[i] > 0) order.push_back(i);
+        }
+        std::stable_sort(order.begin(), order.end(),
+                         [&hits](size_t a, size_t b) { return hits[a] > hits[b]; });
+        out << "[Info]Complete query projection.\n";
+        for (size_t i : order) {
+            print_projection(out, by_name[i]->name, hits[i], trials);
+        }
+    }
+
+    ContestShape shape(const std::string& team_name) const override {
+        ContestShape result;
+        result.teams = static_cast<long long>(team_list.size());
+        for (const auto& team : team_list) {
+            for (const auto& prob : team->problems) {
+                result.frozen_problems += prob.is_frozen;
+            }
+        }
+        result.submissions = submission_count;
+        auto it = teams.find(team_name);
+        if (it != teams.end()) {
+            result.team_submissions = static_cast<long long>(it->second->submissions.size());
+        }
+        return result;
+    }
+
+private:
+    struct Submission {
+        int problem;
+        SubmitStatus status;
+        int time;
+        int seq;
+    };
+
+    struct Problem {
+        int wrong_before = 0;
+        bool solved = false;
+        int solved_time = -1;
+        int solved_seq = 0;
+        bool is_frozen = false;
+        int submissions_after_freeze = 0;
+        int first_frozen_submission = -1;
+    };
+
+    struct Team {
+        std::string name;
+        std::vector<Problem> problems;
+        std::vector<Submission> submissions;
+        long long score = 0;
+        long long penalty_time = 0;
+        std::vector<int> solved_times;
+
+        Team(const std::string& n, int problem_count) : name(n), problems(problem_count) {}
+
+        void calculate_ranking(const Rules& rules, int problem_count) {
+            score = 0;
+            penalty_time = 0;
+            solved_times.clear();
+            for (int i = 0; i < problem_count; i++) {
+                if (problems[i].solved) {
+                    score += rules.problem_score(i);
+                    penalty_time += rules.problem_penalty(problems[i].wrong_before, problems[i].solved_time);
+                    solved_times.push_back(problems[i].solved_time);
+                }
+            }
+            sort(solved_times.rbegin(), solved_times.rend());
+        }
+    };
+
+    struct Compare {
+        bool operator()(const Team* a, const Team* b) const {
+            if (a->score != b->score) return a->score > b->score;
+            if (a->penalty_time != b->penalty_time) return a->penalty_time < b->penalty_time;
+            if (Rules::kSolveTimeTiebreak && a->solved_times != b->solved_times) {
+                return a->solved_times < b->solved_times;
+            }
+            return a->name < b->name;
+        }
+    };
+
+    std::ostream& out;
+    Rules rules;
+    AutoFlushPolicy auto_flush;
+    bool keep_history;
+    std::unordered_map<std::string, Team*> teams;
+    std::vector<std::unique_ptr<Team>> team_list;
+    std::vector<Team*> last_flushed_ranking;
+    std::vector<Team*> watched_teams;
+    std::vector<std::string> watch_events;
+    int duration_time = 0;
+    int problem_count = 0;
+    int submission_count = 0;
+    bool is_frozen = false;
+    bool competition_ended = false;
+    bool flush_pending = false;
+    int pending_flush_time = 0;
+    long long changes_since_flush = 0;
+    int last_flush_time = 0;
+    int latest_time = 0;
+    int freeze_time = 0;
+
+    static int rank_in(const std::vector<Team*>& ranking, const Team* team) {
+        return static_cast<int>(std::find(ranking.begin(), ranking.end(), team) - ranking.begin()) + 1;
+    }
+
+    bool is_watched(const Team* team) const {
+        return std::find(watched_teams.begin(), watched_teams.end(), team) != watched_teams.end();
+    }
+
+    void note_rank_change(Team* team, const std::vector<Team*>& before, const std::vector<Team*>& after) {
+        int old_rank = rank_in(before, team);
+        int new_rank = rank_in(after, team);
+        if (old_rank != new_rank) {
+            watch_events.push_back("[Watch][" + team->name + "] RANKING [" + std::to_string(old_rank) +
+                                   "] -> [" + std::to_string(new_rank) + "]");
+        }
+    }
+
+    void report_watch_events() {
+        for (const auto& event : watch_events) {
+            out << event << "\n";
+        }
+        watch_events.clear();
+    }
+
+    void flush_rankings() {
+        flush_pending = false;
+        changes_since_flush = 0;
+        last_flush_time = latest_time;
+
+        for (const auto& team : team_list) {
+            team->calculate_ranking(rules, problem_count);
+        }
+        std::vector<Team*> ranking = last_flushed_ranking;
+        std::sort(ranking.begin(), ranking.end(), Compare());
+        for (Team* team : watched_teams) {
+            note_rank_change(team, last_flushed_ranking, ranking);
+        }
+        last_flushed_ranking = ranking;
+    }
+
+    bool auto_flush_due(Team* team, bool accepted, int time) {
+        if (auto_flush.submissions && changes_since_flush >= auto_flush.submissions) return true;
+        if (auto_flush.interval && time - last_flush_time >= auto_flush.interval) return true;
+        if (auto_flush.top && accepted) {
+            int top = std::min(auto_flush.top, static_cast<int>(last_flushed_ranking.size()));
+            if (rank_in(last_flushed_ranking, team) <= top) return true;
+
+            team->calculate_ranking(rules, problem_count);
+            return Compare()(team, last_flushed_ranking[top - 1]);
+        }
+        return false;
+    }
+
+    void settle_auto_flush() {
+        if (flush_pending) {
+            flush_rankings();
+            report_watch_events();
+        }
+    }
+
+    // Replays the team's submissions since the problem froze.
+    bool unfreeze(Team* team, int prob_index) {
+        Problem& prob = team->problems[prob_index];
+        bool solved = false;
+        for (size_t i = prob.first_frozen_submission; i < team->submissions.size(); i++) {
+            const Submission& sub = team->submissions[i];
+            if (sub.problem != prob_index) continue;
+            if (sub.status == SubmitStatus::Accepted) {
+                prob.solved = true;
+                prob.solved_time = sub.time;
+                prob.solved_seq = sub.seq;
+                solved = true;
+                break;
+            }
+            prob.wrong_before++;
+        }
+        prob.is_frozen = false;
+        prob.submissions_after_freeze = 0;
+        prob.first_frozen_submission = -1;
+        return solved;
+    }
+
+    bool matches(const Submission& sub, const std::string& problem, const std::string& status) const {
+        SubmitStatus verdict;
+        return (problem == "ALL" || problem_name(sub.problem) == problem) &&
+               (!parse_status(status, verdict) || sub.status == verdict);
+    }
+
+    void print_submission(const std::string& team_name, const Submission& sub) {
+        out << "[" << team_name << "] [" << problem_name(sub.problem) << "] [" << status_name(sub.status)
+            << "] [" << sub.time << "]\n";
+    }
+
+    void print_scoreboard(const std::vector<Team*>& ranking) {
+        int rank = 1;
+        for (const Team* team : ranking) {
+            out << team->name << " " << rank++ << " " << team->score << " " << team->penalty_time;
+            for (int i = 0; i < problem_count; i++) {
+                const Problem& prob = team->problems[i];
+                if (prob.is_frozen) {
+                    out << " " << (prob.wrong_before ? "-" + std::to_string(prob.wrong_before) : "0")
+                        << "/" << prob.submissions_after_freeze;
+                } else if (prob.solved) {
+                    out << " +" << (prob.wrong_before ? std::to_string(prob.wrong_before) : "");
+                } else {
+                    out << " " << (prob.wrong_before ? "-" + std::to_string(prob.wrong_before) : ".");
+                }
+            }
+            out << "\n";
+        }
+    }
+};
+
+// Builds a ReferenceEngine for the configured rules; usable as the
+// ContestFactory of an ICPCManagement.
+std::unique_ptr<Contest> make_reference_contest(const ContestOptions& options,
+                                                const std::vector<std::string>& roster,
+                                                int duration, int problem_count, std::ostream& out);
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <utility>
+
+// A SUBMIT held back until later ones show it can no longer be overtaken.
+struct PendingSubmission {
+    std::string problem;
+    std::string team_name;
+    std::string status;
+    int time = 0;
+};
+
+// Puts submissions that arrive slightly out of time order back in order.
+// The watermark trails the latest time seen by `window`; a submission is
+// released once the watermark reaches it, earliest time first and in
+// arrival order for equal times. A submission arriving after a later time
+// was already released cannot be put back in order; it is passed on at
+// once and reported as late.
+//
+// Held submissions sit in a deque sorted by time. Arrivals are mostly in
+// order, so an insert is usually an append and a release a pop from the
+// front; a late arrival moves only the entries that overtook it.
+class ReorderBuffer {
+public:
+    explicit ReorderBuffer(int window) : window(window) {}
+
+    // Holds `submission` and calls release(const PendingSubmission&) for
+    // every submission the watermark has now passed. Returns true if the
+    // submission came too late to be put in order.
+    template <class Release>
+    bool push(PendingSubmission submission, Release release) {
+        bool late = submission.time < released_time;
+        latest_time = std::max(latest_time, submission.time);
+        if (held.empty() || held.back().time <= submission.time) {
+            held.push_back(std::move(submission));
+        } else {
+            // After every held submission with the same or an earlier time
+            auto position = std::upper_bound(
+                held.begin(), held.end(), submission.time,
+                [](int time, const PendingSubmission& other) { return time < other.time; });
+            held.insert(position, std::move(submission));
+        }
+        long long watermark = static_cast<long long>(latest_time) - window;
+        while (!held.empty() && held.front().time <= watermark) release_front(release);
+        return late;
+    }
+
+    // Releases everything held; run before any command that reads state.
+    template <class Release>
+    void drain(Release release) {
+        while (!held.empty()) release_front(release);
+    }
+
+    std::size_t size() const { return held.size(); }
+
+private:
+    template <class Release>
+    void release_front(Release& release) {
+        released_time = std::max(released_time, held.front().time);
+        release(held.front());
+        held.pop_front();
+    }
+
+    int window;
+    int latest_time = 0;
+    int released_time = 0;
+    std::deque<PendingSubmission> held;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+
+// Ranking policies. An engine is instantiated with one of these, so the
+// scoring and comparison code is resolved at compile time. Each policy
+// supplies:
+//   problem_score(i)        what solving problem i is worth
+//   problem_penalty(w, t)   penalty for a solve at time t after w wrong tries
+//   kSolveTimeTiebreak      whether equal score and penalty fall back to
+//                           comparing solve times, largest first
+// Teams still tied after that are ordered by name.
+
+template <int WrongPenalty, bool SolveTimeTiebreak>
+struct PenaltyRules {
+    static constexpr bool kSolveTimeTiebreak = SolveTimeTiebreak;
+
+    int problem_score(int) const { return 1; }
+    long long problem_penalty(int wrong_before, int solved_time) const {
+        return 1LL * WrongPenalty * wrong_before + solved_time;
+    }
+};
+
+using IcpcRules = PenaltyRules<20, true>;
+using ShortPenaltyRules = PenaltyRules<10, true>;
+using UntimedRules = PenaltyRules<20, false>;
+
+// ICPC penalties, but each problem is worth its own weight (1 if unset).
+struct WeightedRules {
+    static constexpr bool kSolveTimeTiebreak = true;
+
+    std::vector<int> weights;
+
+    int problem_score(int prob_index) const {
+        return prob_index < (int)weights.size() ? weights[prob_index] : 1;
+    }
+    long long problem_penalty(int wrong_before, int solved_time) const {
+        return 20LL * wrong_before + solved_time;
+    }
+};
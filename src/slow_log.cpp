@@ -0,0 +1,26 @@
+#include "slow_log.hpp"
+
+#include "command.hpp"
+
+SlowCommandLog::SlowCommandLog(const std::string& path, long long threshold)
+    : file(std::fopen(path.c_str(), "a")), threshold_ms(static_cast<double>(threshold)) {}
+
+SlowCommandLog::~SlowCommandLog() {
+    if (file) std::fclose(file);
+}
+
+void SlowCommandLog::record(std::string_view line, double elapsed_ms, const ICPCManagement& system) {
+    if (elapsed_ms < threshold_ms || !file) return;
+
+    ContestShape shape = system.shape(command_team(line));
+    std::fprintf(file,
+                 "[Slow] %.3f ms teams=%lld frozen_problems=%lld dirty_teams=%lld submissions=%lld",
+                 elapsed_ms, shape.teams, shape.frozen_problems, shape.dirty_teams,
+                 shape.submissions);
+    if (shape.team_submissions >= 0) {
+        std::fprintf(file, " team_submissions=%lld", shape.team_submissions);
+    }
+    std::fprintf(file, " | %.*s\n", static_cast<int>(line.size()), line.data());
+    // Entries should survive a crash right after a spike.
+    std::fflush(file);
+}
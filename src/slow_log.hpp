@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include "icpc_management.hpp"
+
+// Opt-in log of commands slower than a threshold. Each entry carries the
+// contest's shape after the command, so latency spikes can be matched to
+// board size, pending flush work or a team's history length.
+class SlowCommandLog {
+public:
+    SlowCommandLog(const std::string& path, long long threshold_ms);
+    ~SlowCommandLog();
+
+    SlowCommandLog(const SlowCommandLog&) = delete;
+    SlowCommandLog& operator=(const SlowCommandLog&) = delete;
+
+    bool ok() const { return file != nullptr; }
+
+    // Logs `line` if it took longer than the threshold.
+    void record(std::string_view line, double elapsed_ms, const ICPCManagement& system);
+
+private:
+    std::FILE* file;
+    double threshold_ms;
+};
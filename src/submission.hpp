@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+
+enum class SubmitStatus : unsigned char {
+    Accepted,
+    Wrong_Answer,
+    Runtime_Error,
+    Time_Limit_Exceed,
+};
+
+constexpr int kStatusCount = 4;
+
+inline const char* status_name(SubmitStatus status) {
+    static const char* const names[kStatusCount] = {
+        "Accepted", "Wrong_Answer", "Runtime_Error", "Time_Limit_Exceed",
+    };
+    return names[static_cast<int>(status)];
+}
+
+// Returns false for anything that is not one of the four judge verdicts
+// (in particular for the "ALL" wildcard used by queries).
+inline bool parse_status(const std::string& text, SubmitStatus& status) {
+    for (int i = 0; i < kStatusCount; i++) {
+        if (text == status_name(static_cast<SubmitStatus>(i))) {
+            status = static_cast<SubmitStatus>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+struct SubmissionRecord {
+    unsigned char problem;  // index, see problem_id.hpp
+    SubmitStatus status;
+    int time;
+    SubmissionRecord(int p, SubmitStatus s, int t)
+        : problem(static_cast<unsigned char>(p)), status(s), time(t) {}
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Judge-assigned submission ids seen so far. Open addressing with linear
+// probing over a flat array of ids, kept at most half full, so an insert
+// costs one or two cache lines whether or not the id is new. Ids are
+// stored plus one so that zero can mark an empty slot.
+class SubmissionIdSet {
+public:
+    // Returns false if `id` was already present.
+    bool insert(std::uint64_t id) {
+        if ((count + 1) * 2 > slots.size()) grow();
+        std::uint64_t key = id + 1;
+        std::size_t mask = slots.size() - 1;
+        for (std::size_t i = mix(key) & mask;; i = (i + 1) & mask) {
+            if (slots[i] == key) return false;
+            if (slots[i] == 0) {
+                slots[i] = key;
+                count++;
+                return true;
+            }
+        }
+    }
+
+    std::size_t size() const { return count; }
+    std::size_t bytes() const { return slots.capacity() * sizeof(std::uint64_t); }
+
+private:
+    // Judges tend to hand out consecutive ids; spread them over the table.
+    static std::size_t mix(std::uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return static_cast<std::size_t>(key);
+    }
+
+    void grow() {
+        std::vector<std::uint64_t> old(slots.empty() ? 1024 : slots.size() * 2, 0);
+        old.swap(slots);
+        std::size_t mask = slots.size() - 1;
+        for (std::uint64_t key : old) {
+            if (key == 0) continue;
+            std::size_t i = mix(key) & mask;
+            while (slots[i] != 0) i = (i + 1) & mask;
+            slots[i] = key;
+        }
+    }
+
+    std::vector<std::uint64_t> slots;
+    std::size_t count = 0;
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "memory_account.hpp"
+#include "submission.hpp"
+
+// Append-only history of every submission in the contest, one column per
+// field. Records are stored in fixed-size chunks, so an append never moves
+// existing data and ingestion is a sequential write. Each record links to
+// the previous record of the same team, giving every team a newest-first
+// chain through the shared columns. A chain is kept sorted by time: a
+// record older than the team's newest is spliced in after every record
+// with the same or an earlier time, so equal times stay in arrival order.
+// Every kIndexStride-th appended record of a team is sampled into a small
+// per-team index, so a time can be located by binary searching the samples
+// and walking one stride of chain plus whatever was spliced into it.
+class SubmissionStore {
+public:
+    static constexpr std::uint32_t kNone = UINT32_MAX;
+
+    // All of the store's memory is charged to `account`.
+    SubmissionStore(size_t team_count, MemoryAccount* account)
+        : chunk_allocator(account), chunks(CountingAllocator<Chunk*>(account)),
+          teams(team_count, TeamHistory(account), CountingAllocator<TeamHistory>(account)) {}
+
+    ~SubmissionStore() {
+        for (Chunk* chunk : chunks) {
+            std::allocator_traits<ChunkAllocator>::deallocate(chunk_allocator, chunk, 1);
+        }
+    }
+
+    SubmissionStore(const SubmissionStore&) = delete;
+    SubmissionStore& operator=(const SubmissionStore&) = delete;
+
+    void append(int team, int problem, SubmitStatus status, int time) {
+        size_t offset = count & kChunkMask;
+        if (offset == 0) {
+            // Chunks hold plain arrays, so no constructor has to run.
+            chunks.push_back(std::allocator_traits<ChunkAllocator>::allocate(chunk_allocator, 1));
+        }
+        Chunk& chunk = *chunks.back();
+        TeamHistory& history = teams[team];
+        chunk.time[offset] = time;
+        chunk.team[offset] = team;
+        chunk.problem[offset] = static_cast<unsigned char>(problem);
+        chunk.status[offset] = status;
+        if (history.last != kNone && this->time(history.last) > time) {
+            splice(history, time);
+            return;
+        }
+        chunk.prev[offset] = history.last;
+        if (history.count++ % kIndexStride == 0) {
+            history.samples.push_back(count);
+        }
+        history.last = count++;
+    }
+
+    std::uint32_t size() const { return count; }
+
+    // Number of records of a team.
+    std::uint32_t count_of(int team) const { return teams[team].count; }
+    // Newest record of a team, or kNone.
+    std::uint32_t last_of(int team) const { return teams[team].last; }
+    // The same team's record before `index`, or kNone.
+    std::uint32_t prev(std::uint32_t index) const { return chunk_of(index).prev[index & kChunkMask]; }
+
+    // Newest record of a team with a time of at most `time`, or kNone.
+    std::uint32_t last_at_or_before(int team, int time) const {
+        const TeamHistory& history = teams[team];
+        // The oldest sample past `time`; everything newer is past it too.
+        auto later = std::upper_bound(history.samples.begin(), history.samples.end(), time,
+                                      [this](int t, std::uint32_t index) { return t < this->time(index); });
+        std::uint32_t index = later == history.samples.end() ? history.last : prev(*later);
+        while (index != kNone && this->time(index) > time) index = prev(index);
+        return index;
+    }
+
+    int time(std::uint32_t index) const { return chunk_of(index).time[index & kChunkMask]; }
+    int team(std::uint32_t index) const { return chunk_of(index).team[index & kChunkMask]; }
+    int problem(std::uint32_t index) const { return chunk_of(index).problem[index & kChunkMask]; }
+    SubmitStatus status(std::uint32_t index) const { return chunk_of(index).status[index & kChunkMask]; }
+
+    SubmissionRecord record(std::uint32_t index) const {
+        return SubmissionRecord(problem(index), status(index), time(index));
+    }
+
+private:
+    static constexpr unsigned kChunkBits = 16;
+    static constexpr std::uint32_t kChunkSize = 1u << kChunkBits;
+    static constexpr std::uint32_t kChunkMask = kChunkSize - 1;
+    static constexpr std::uint32_t kIndexStride = 64;
+
+    struct Chunk {
+        int time[kChunkSize];
+        int team[kChunkSize];
+        std::uint32_t prev[kChunkSize];
+        unsigned char problem[kChunkSize];
+        SubmitStatus status[kChunkSize];
+    };
+
+    // Head of a team's chain and its sampled records, oldest first.
+    struct TeamHistory {
+        std::uint32_t last = kNone;
+        std::uint32_t count = 0;
+        CountedVector<std::uint32_t> samples;
+
+        explicit TeamHistory(MemoryAccount* account) : samples(CountingAllocator<std::uint32_t>(account)) {}
+    };
+
+    using ChunkAllocator = CountingAllocator<Chunk>;
+
+    ChunkAllocator chunk_allocator;
+    CountedVector<Chunk*> chunks;
+    CountedVector<TeamHistory> teams;
+    std::uint32_t count = 0;
+
+    const Chunk& chunk_of(std::uint32_t index) const { return *chunks[index >> kChunkBits]; }
+    Chunk& chunk_of(std::uint32_t index) { return *chunks[index >> kChunkBits]; }
+
+    // Links the record just written at `count`, older than the team's
+    // newest, into the chain behind the newer records. The walk from the
+    // head covers only records that overtook it. Spliced records are never
+    // sampled, so the samples stay in chain order.
+    void splice(TeamHistory& history, int time) {
+        std::uint32_t newer = history.last;
+        std::uint32_t older = prev(newer);
+        while (older != kNone && this->time(older) > time) {
+            newer = older;
+            older = prev(older);
+        }
+        chunk_of(count).prev[count & kChunkMask] = older;
+        chunk_of(newer).prev[newer & kChunkMask] = count;
+        history.count++;
+        count++;
+    }
+};
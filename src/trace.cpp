@@ -0,0 +1,34 @@
+#include "trace.hpp"
+
+#include <unistd.h>
+
+bool Tracer::start(const std::string& path) {
+    stop();
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) return false;
+
+    active = new Tracer;
+    active->file = file;
+    active->origin = Clock::now();
+    std::fputs("{\"traceEvents\":[\n", file);
+    return true;
+}
+
+void Tracer::stop() {
+    if (!active) return;
+
+    std::fputs("\n]}\n", active->file);
+    std::fclose(active->file);
+    delete active;
+    active = nullptr;
+}
+
+void Tracer::record(const char* name, Clock::time_point begin, Clock::time_point end) {
+    using Micros = std::chrono::duration<double, std::micro>;
+    std::fprintf(active->file,
+                 "%s{\"name\":\"%s\",\"cat\":\"icpc\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                 "\"pid\":%d,\"tid\":1}",
+                 active->first ? "" : ",\n", name, Micros(begin - active->origin).count(),
+                 Micros(end - begin).count(), static_cast<int>(getpid()));
+    active->first = false;
+}
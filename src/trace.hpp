@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+// Optional Chrome trace-event output (load the file in chrome://tracing or
+// Perfetto). While no trace is open, a span costs one pointer test at each
+// end.
+class Tracer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Starts writing events to `path`. Returns false if it cannot be opened.
+    static bool start(const std::string& path);
+    // Closes the event list and the file.
+    static void stop();
+
+    static bool enabled() { return active != nullptr; }
+    static void record(const char* name, Clock::time_point begin, Clock::time_point end);
+
+private:
+    inline static Tracer* active = nullptr;
+
+    std::FILE* file = nullptr;
+    Clock::time_point origin;
+    bool first = true;
+};
+
+// Records the time from construction to destruction as one event.
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* span_name) : name(span_name) {
+        if (Tracer::enabled()) begin = Tracer::Clock::now();
+    }
+    ~TraceSpan() {
+        if (Tracer::enabled()) Tracer::record(name, begin, Tracer::Clock::now());
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    // For spans named after what they turned out to cover.
+    void rename(const char* span_name) { name = span_name; }
+
+private:
+    const char* name;
+    Tracer::Clock::time_point begin;
+};
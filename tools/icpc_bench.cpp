@@ -0,0 +1,448 @@
+// Replays a synthetic contest through the engine and reports latency per
+// command type. Output goes to a discarding stream, so formatting is
+// measured but not the terminal.
+//
+//   icpc_bench --teams=1000000 --problems=10 --submissions=10000000
+//
+// --counters also reads cycles, instructions, cache misses and branch misses
+// around every command and reports them per command type.
+//
+// --scaling replays the contest at doubling sizes up to --teams, fits how
+// each command's engine time grows with N and exits 1 if one grows faster
+// than its bound. ctest runs it as the complexity_scaling test:
+//
+//   icpc_bench --scaling --teams=64000 --submissions=256000 --flushes=100
+//
+// --compare-allocators runs the same replay once per --allocator strategy,
+// each in its own process.
+//
+// --scenario=NAME replays one of the worst cases in scenarios.hpp instead;
+// --scenario=all runs each in its own process so peak RSS is per scenario.
+//
+//   icpc_bench --scenario=all --teams=10000 --submissions=100000
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "command.hpp"
+#include "icpc_management.hpp"
+#include "perf_counters.hpp"
+#include "scenarios.hpp"
+#include "workload.hpp"
+
+using namespace std;
+
+namespace {
+
+class DiscardBuffer : public streambuf {
+protected:
+    int_type overflow(int_type c) override { return c; }
+    streamsize xsputn(const char*, streamsize n) override { return n; }
+};
+
+struct CommandStats {
+    long long count = 0;
+    double total_ms = 0;
+    double max_ms = 0;
+    PerfCounters::Values counters{};
+};
+
+bool parse_bench_option(const string& arg, WorkloadConfig& config, string& scenario,
+                        bool& counters, bool& scaling, bool& compare_allocators,
+                        ContestOptions& options) {
+    size_t eq = arg.find('=');
+    string name = arg.substr(0, eq);
+    string value = eq == string::npos ? "" : arg.substr(eq + 1);
+    try {
+        if (name == "--teams") {
+            config.teams = stoll(value);
+        } else if (name == "--problems") {
+            config.problems = stoi(value);
+        } else if (name == "--submissions") {
+            config.submissions = stoll(value);
+        } else if (name == "--flushes") {
+            config.flushes = stoll(value);
+        } else if (name == "--queries") {
+            config.queries = stoll(value);
+        } else if (name == "--freeze-fraction") {
+            config.freeze_fraction = stod(value);
+        } else if (name == "--seed") {
+            config.seed = stoull(value);
+        } else if (name == "--scenario") {
+            scenario = value;
+        } else if (arg == "--counters") {
+            counters = true;
+        } else if (arg == "--scaling") {
+            scaling = true;
+        } else if (arg == "--compare-allocators") {
+            compare_allocators = true;
+        } else {
+            return parse_option(arg, options);
+        }
+    } catch (...) {
+        return false;
+    }
+    return true;
+}
+
+long peak_rss_kb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Anonymous memory currently backed by transparent huge pages.
+long huge_pages_kb() {
+    FILE* smaps = fopen("/proc/self/smaps_rollup", "r");
+    if (!smaps) return 0;
+    char line[256];
+    long kb = 0;
+    while (fgets(line, sizeof(line), smaps)) {
+        if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1) break;
+    }
+    fclose(smaps);
+    return kb;
+}
+
+struct ReplayResult {
+    double wall_seconds = 0;
+    long huge_pages_kb = 0;
+};
+
+// Replays every line of `source` into stats, indexed by CommandType.
+template <class Source>
+ReplayResult replay(Source& source, const ContestOptions& options, PerfCounters* perf,
+                    CommandStats* stats, ContestFactory factory = make_contest) {
+    DiscardBuffer discard;
+    ostream out(&discard);
+    ICPCManagement system(options, out, factory);
+
+    string line;
+    auto started = chrono::steady_clock::now();
+    while (source.next(line)) {
+        PerfCounters::Values counters_before{};
+        if (perf) counters_before = perf->read();
+        auto before = chrono::steady_clock::now();
+        CommandType type = execute_command(system, line);
+        chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - before;
+
+        CommandStats& entry = stats[static_cast<int>(type)];
+        entry.count++;
+        entry.total_ms += elapsed.count();
+        entry.max_ms = max(entry.max_ms, elapsed.count());
+        if (perf) {
+            PerfCounters::Values counters_after = perf->read();
+            for (int i = 0; i < PerfCounters::kCount; i++) {
+                entry.counters[i] += counters_after[i] - counters_before[i];
+            }
+        }
+    }
+    ReplayResult result;
+    result.wall_seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    // While the engine still holds its memory
+    result.huge_pages_kb = huge_pages_kb();
+    return result;
+}
+
+// Replays every line of `source` and prints the per-command table.
+template <class Source>
+void run(Source& source, const ContestOptions& options, bool counters) {
+    unique_ptr<PerfCounters> perf;
+    if (counters) {
+        perf = make_unique<PerfCounters>();
+        if (!perf->ok()) {
+            printf("counters unavailable: %s\n", perf->error().c_str());
+            perf.reset();
+        }
+    }
+
+    CommandStats stats[kCommandTypeCount];
+    ReplayResult result = replay(source, options, perf.get(), stats);
+
+    printf("%-18s %10s %12s %12s %12s\n", "command", "count", "total_ms", "mean_us", "max_ms");
+    for (int i = 0; i < kCommandTypeCount; i++) {
+        const CommandStats& entry = stats[i];
+        if (entry.count == 0) continue;
+        printf("%-18s %10lld %12.1f %12.2f %12.3f\n", command_name(static_cast<CommandType>(i)),
+               entry.count, entry.total_ms, entry.total_ms * 1000 / entry.count, entry.max_ms);
+    }
+    if (perf) {
+        // Per command, except IPC. Includes the parsing in execute_command.
+        printf("%-18s", "command");
+        for (int i = 0; i < PerfCounters::kCount; i++) {
+            printf(" %14s", PerfCounters::name(i));
+        }
+        printf(" %6s\n", "ipc");
+        for (int i = 0; i < kCommandTypeCount; i++) {
+            const CommandStats& entry = stats[i];
+            if (entry.count == 0) continue;
+            printf("%-18s", command_name(static_cast<CommandType>(i)));
+            for (int counter = 0; counter < PerfCounters::kCount; counter++) {
+                if (perf->available(counter)) {
+                    printf(" %14.1f", static_cast<double>(entry.counters[counter]) / entry.count);
+                } else {
+                    printf(" %14s", "n/a");
+                }
+            }
+            double cycles = static_cast<double>(entry.counters[0]);
+            printf(" %6.2f\n", cycles > 0 ? entry.counters[1] / cycles : 0.0);
+        }
+    }
+    printf("wall %.2f s, peak RSS %.1f MiB, huge pages %.1f MiB\n", result.wall_seconds,
+           peak_rss_kb() / 1024.0, result.huge_pages_kb / 1024.0);
+}
+
+// Returns false, having replayed nothing, for an unknown name.
+bool run_scenario(const string& name, const WorkloadConfig& config, const ContestOptions& options,
+                  bool counters) {
+    ScenarioGenerator scenario;
+    if (!scenario.select(name, config)) return false;
+    printf("scenario %s: teams=%lld problems=%d submissions=%lld flushes=%lld queries=%lld\n",
+           name.c_str(), config.teams, config.problems, config.submissions, config.flushes,
+           config.queries);
+    run(scenario, options, counters);
+    return true;
+}
+
+// Runs `body` in a forked child and waits for it; fails if `body` returns
+// false. ru_maxrss never goes down, so this is how runs in one invocation
+// get separate peak RSS.
+template <class Body>
+bool run_in_child(const Body& body) {
+    fflush(stdout);
+    pid_t child = fork();
+    if (child == 0) {
+        bool ok = body();
+        fflush(stdout);
+        _exit(ok ? 0 : 1);
+    }
+    int status = 0;
+    return child > 0 && waitpid(child, &status, 0) == child && WIFEXITED(status) &&
+           WEXITSTATUS(status) == 0;
+}
+
+// Accepts every command and does nothing with it. Replaying a contest
+// through it measures parsing and dispatch alone, which --scaling takes
+// off the engine's time.
+class NullContest : public Contest {
+public:
+    void submit(const string&, const string&, const string&, int) override {}
+    void flush_scoreboard() override {}
+    void freeze_scoreboard() override {}
+    void scroll_scoreboard() override {}
+    void query_ranking(const string&) override {}
+    void query_submission(const string&, const string&, const string&) override {}
+    void query_submissions(const string&, int, int, const string&, const string&) override {}
+    void query_problems() override {}
+    void watch_team(const string&) override {}
+    void unwatch_team(const string&) override {}
+    void end_competition() override {}
+    void query_memory() override {}
+    void query_projection(int, int) override {}
+    ContestShape shape(const string&) const override { return ContestShape(); }
+};
+
+unique_ptr<Contest> make_null_contest(const ContestOptions&, const vector<string>&, int, int,
+                                      ostream&) {
+    return make_unique<NullContest>();
+}
+
+// Growth bound per command type, as the largest acceptable exponent k in
+// engine time ~ N^k when teams and submissions grow together. Engine time
+// is the mean time minus that of the same replay through NullContest;
+// ADDTEAM is handled before any engine exists, so it keeps its full time.
+// Cache and TLB misses lift O(1) commands to 0.4-0.6 over 1000 to 64000
+// teams, while a linear scan measures 0.9 even over 250 to 16000 and 1.2
+// over 1000 to 64000, so 0.85 sits between. START, FLUSH and SCROLL
+// measure 1.1-1.45; a quadratic step lands near 2.
+struct ScalingBound {
+    CommandType type;
+    double max_exponent;
+};
+
+const ScalingBound kScalingBounds[] = {
+    {CommandType::AddTeam, 0.85},      {CommandType::Start, 1.75},
+    {CommandType::Submit, 0.85},       {CommandType::Flush, 1.75},
+    {CommandType::Scroll, 1.75},       {CommandType::QueryRanking, 0.85},
+    {CommandType::QuerySubmission, 0.85},
+};
+
+constexpr int kScalingSteps = 7;
+// Each size keeps its fastest of this many replays, which filters out
+// interference from the rest of the machine.
+constexpr int kScalingRepeats = 3;
+
+// Median of the slopes of log(mean time) against log(teams) over every
+// pair of sizes. Unlike a least-squares fit, one size whose time came out
+// wrong can't swing it.
+double growth_exponent(const vector<double>& teams, const vector<double>& mean_ms) {
+    vector<double> slopes;
+    for (size_t i = 0; i < teams.size(); i++) {
+        for (size_t j = i + 1; j < teams.size(); j++) {
+            slopes.push_back((log(max(mean_ms[j], 1e-9)) - log(max(mean_ms[i], 1e-9))) /
+                             (log(teams[j]) - log(teams[i])));
+        }
+    }
+    nth_element(slopes.begin(), slopes.begin() + slopes.size() / 2, slopes.end());
+    return slopes[slopes.size() / 2];
+}
+
+// Replays the random contest at kScalingSteps sizes, doubling up to
+// config.teams, once through the engine and once through NullContest.
+// Submissions per team, flush count and query count stay fixed, so every
+// command's own input grows with N. Returns whether every bound in
+// kScalingBounds held.
+bool run_scaling(const WorkloadConfig& config, const ContestOptions& options) {
+    double submissions_per_team = static_cast<double>(config.submissions) / config.teams;
+    vector<double> sizes;
+    vector<vector<double>> means(kCommandTypeCount);
+    for (int step = 0; step < kScalingSteps; step++) {
+        WorkloadConfig scaled = config;
+        scaled.teams = max(1LL, config.teams >> (kScalingSteps - 1 - step));
+        scaled.submissions = static_cast<long long>(submissions_per_team * scaled.teams);
+        sizes.push_back(static_cast<double>(scaled.teams));
+        vector<double> fastest(kCommandTypeCount, HUGE_VAL);
+        for (int repeat = 0; repeat < kScalingRepeats; repeat++) {
+            WorkloadGenerator workload(scaled);
+            WorkloadGenerator dispatch_only(scaled);
+            CommandStats stats[kCommandTypeCount];
+            CommandStats dispatch_stats[kCommandTypeCount];
+            replay(workload, options, nullptr, stats);
+            replay(dispatch_only, options, nullptr, dispatch_stats, make_null_contest);
+            for (int i = 0; i < kCommandTypeCount; i++) {
+                if (stats[i].count == 0) continue;
+                double mean = stats[i].total_ms / stats[i].count;
+                if (static_cast<CommandType>(i) != CommandType::AddTeam) {
+                    mean -= dispatch_stats[i].total_ms / dispatch_stats[i].count;
+                }
+                fastest[i] = min(fastest[i], mean);
+            }
+        }
+        for (int i = 0; i < kCommandTypeCount; i++) {
+            // Keeps the log defined if dispatch ever measures slower.
+            means[i].push_back(fastest[i] == HUGE_VAL ? 0 : max(fastest[i], 1e-7));
+        }
+    }
+
+    printf("%-18s", "command");
+    for (double size : sizes) {
+        printf(" %10.0f", size);
+    }
+    printf(" %9s %6s\n", "exponent", "limit");
+
+    bool passed = true;
+    for (const auto& bound : kScalingBounds) {
+        const vector<double>& mean_ms = means[static_cast<int>(bound.type)];
+        if (find(mean_ms.begin(), mean_ms.end(), 0.0) != mean_ms.end()) continue;
+
+        double exponent = growth_exponent(sizes, mean_ms);
+        bool ok = exponent <= bound.max_exponent;
+        passed = passed && ok;
+        printf("%-18s", command_name(bound.type));
+        for (double mean : mean_ms) {
+            printf(" %10.5f", mean);
+        }
+        printf(" %9.2f %6.2f%s\n", exponent, bound.max_exponent, ok ? "" : "  FAIL");
+    }
+    printf("mean engine ms per command; %s\n", passed ? "all bounds hold" : "growth bound exceeded");
+    return passed;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    WorkloadConfig config;
+    ContestOptions options;
+    string scenario;
+    bool counters = false;
+    bool scaling = false;
+    bool compare_allocators = false;
+    bool parsed = true;
+    for (int i = 1; i < argc && parsed; i++) {
+        parsed = parse_bench_option(argv[i], config, scenario, counters, scaling, compare_allocators,
+                                    options);
+    }
+    if (!parsed || !options_consistent(options)) {
+        cerr << "usage: " << argv[0]
+             << " [--teams=N] [--problems=M] [--submissions=S] [--flushes=F]"
+                " [--queries=Q] [--freeze-fraction=X] [--seed=N] [--scenario=NAME|all]"
+                " [--counters] [--scaling] [--compare-allocators] [engine options]\n"
+             << option_help();
+        return 2;
+    }
+
+    const auto& names = ScenarioGenerator::names();
+    if (!scenario.empty() && scenario != "all" &&
+        find(names.begin(), names.end(), scenario) == names.end()) {
+        cerr << "unknown scenario " << scenario << "; one of:";
+        for (const auto& name : names) {
+            cerr << " " << name;
+        }
+        cerr << " all\n";
+        return 2;
+    }
+
+    if (scaling) {
+        return run_scaling(config, options) ? 0 : 1;
+    }
+    if (compare_allocators) {
+        const pair<AllocatorKind, const char*> kinds[] = {{AllocatorKind::Heap, "heap"},
+                                                          {AllocatorKind::Arena, "arena"},
+                                                          {AllocatorKind::HugePages, "hugepage"}};
+        int failures = 0;
+        for (const auto& [kind, name] : kinds) {
+            ContestOptions variant = options;
+            variant.allocator = kind;
+            printf("allocator %s\n", name);
+            bool ok = run_in_child([&] {
+                if (scenario.empty()) {
+                    WorkloadGenerator workload(config);
+                    run(workload, variant, counters);
+                    return true;
+                }
+                if (scenario != "all") return run_scenario(scenario, config, variant, counters);
+                bool all_ok = true;
+                for (const auto& name : names) {
+                    all_ok = run_scenario(name, config, variant, counters) && all_ok;
+                }
+                return all_ok;
+            });
+            failures += !ok;
+            printf("\n");
+        }
+        return failures ? 1 : 0;
+    }
+    if (scenario.empty()) {
+        WorkloadGenerator workload(config);
+        printf("teams=%lld problems=%d submissions=%lld flushes=%lld queries=%lld\n",
+               config.teams, config.problems, config.submissions, config.flushes, config.queries);
+        run(workload, options, counters);
+        return 0;
+    }
+
+    if (scenario != "all") {
+        return run_scenario(scenario, config, options, counters) ? 0 : 1;
+    }
+
+    int failures = 0;
+    for (const auto& name : names) {
+        if (!run_in_child([&] { return run_scenario(name, config, options, counters); })) {
+            printf("scenario %s failed\n", name.c_str());
+            failures++;
+        }
+        printf("\n");
+    }
+    return failures ? 1 : 0;
+}
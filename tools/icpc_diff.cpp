@@ -0,0 +1,298 @@
+// Differential check of the engine against the reference implementation in
+// src/reference_engine.hpp. Random command streams, covering every command
+// and the malformed cases, are replayed through both under several option
+// sets; any difference in output is reported with the seed that produced it.
+//
+//   icpc_diff --cases=2000 --seed=1
+//
+// Afterwards one synthetic contest is replayed through both engines to
+// report how far the optimised one is ahead.
+//
+// With --history the engine is instead checked against itself: every
+// option set is replayed with and without --no-history, which must print
+// the same bytes. QUERY_SUBMISSIONS, which --no-history refuses, is left
+// out of those streams.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "command.hpp"
+#include "icpc_management.hpp"
+#include "problem_id.hpp"
+#include "reference_engine.hpp"
+#include "workload.hpp"
+
+using namespace std;
+
+namespace {
+
+const char* const kStatuses[] = {"Accepted", "Wrong_Answer", "Runtime_Error", "Time_Limit_Exceed"};
+
+const vector<vector<string>> kOptionSets = {
+    {},
+    {"--rules=icpc-10"},
+    {"--rules=untimed"},
+    {"--rules=weighted", "--weights=3,1,2,5,1,4"},
+    // Solves worth nothing or less move a team down, not up.
+    {"--rules=weighted", "--weights=0,1"},
+    {"--rules=weighted", "--weights=2,-1,0,1"},
+    {"--no-history"},
+    {"--auto-flush-submissions=3"},
+    {"--auto-flush-interval=4"},
+    {"--auto-flush-top=2"},
+    {"--auto-flush-submissions=5", "--auto-flush-interval=10", "--auto-flush-top=1"},
+    {"--reorder-window=2", "--auto-flush-interval=4"},
+    {"--projection-threads=3"},
+    {"--allocator=arena"},
+    {"--allocator=hugepage"},
+};
+
+// One random contest. A few teams and frequent ties keep the scroll and
+// watch paths busy; occasional bad names, problems and statuses exercise
+// the error handling.
+class CaseGenerator {
+public:
+    explicit CaseGenerator(uint64_t seed) : rng(seed) {}
+
+    vector<string> generate() {
+        vector<string> lines;
+        int team_count = pick(1, 12);
+        int problem_count = pick(1, 2) == 1 ? pick(1, 6) : pick(1, kMaxProblems);
+        // Few distinct times and a high accept rate make equal keys likely.
+        int time_step = pick(0, 3);
+        int accept_percent = pick(10, 80);
+
+        for (int i = 0; i < team_count; i++) {
+            names.push_back("t" + to_string(i) + "_" + static_cast<char>('a' + pick(0, 5)));
+            lines.push_back("ADDTEAM " + names.back());
+        }
+        lines.push_back("ADDTEAM " + names[0]);
+        if (pick(0, 4) == 0) {
+            lines.push_back("FLUSH");
+        }
+        lines.push_back("START DURATION 1000 PROBLEM " + to_string(problem_count));
+        lines.push_back("ADDTEAM late");
+        lines.push_back("START DURATION 1000 PROBLEM 3");
+
+        // Judge ids on some cases, with redeliveries of earlier SUBMITs.
+        bool with_ids = pick(0, 2) == 0;
+        vector<string> delivered;
+        // And SUBMITs out of time order on some, often by more than any
+        // reorder window.
+        bool with_late = pick(0, 2) == 0;
+
+        int time = 1;
+        int commands = pick(5, 300);
+        for (int i = 0; i < commands; i++) {
+            int roll = pick(0, 99);
+            if (roll < 55) {
+                if (with_ids && !delivered.empty() && pick(0, 9) == 0) {
+                    lines.push_back(delivered[pick(0, static_cast<int>(delivered.size()) - 1)]);
+                    continue;
+                }
+                time += pick(0, time_step);
+                int at = with_late && pick(0, 5) == 0 ? pick(1, time) : time;
+                string status = pick(0, 99) < accept_percent ? "Accepted" : kStatuses[pick(1, 3)];
+                lines.push_back("SUBMIT " + problem(problem_count) + " BY " + team() + " WITH " +
+                                status + " AT " + to_string(at));
+                if (with_ids) {
+                    lines.back() += " ID " + to_string(delivered.size());
+                    delivered.push_back(lines.back());
+                }
+            } else if (roll < 61) {
+                lines.push_back("FLUSH");
+            } else if (roll < 65) {
+                lines.push_back("FREEZE");
+            } else if (roll < 69) {
+                lines.push_back("SCROLL");
+            } else if (roll < 76) {
+                lines.push_back("QUERY_RANKING " + team());
+            } else if (roll < 83) {
+                lines.push_back("QUERY_SUBMISSION " + team() + " WHERE PROBLEM=" +
+                                filter_problem(problem_count) + " AND STATUS=" + filter_status());
+            } else if (roll < 88) {
+                int from = pick(0, time + 1);
+                string line = "QUERY_SUBMISSIONS " + team() + " BETWEEN " + to_string(from) + " AND " +
+                              to_string(from + pick(0, 10));
+                if (pick(0, 1)) {
+                    line += " WHERE PROBLEM=" + filter_problem(problem_count) +
+                            " AND STATUS=" + filter_status();
+                }
+                lines.push_back(line);
+            } else if (roll < 91) {
+                lines.push_back("QUERY_PROBLEMS");
+            } else if (roll < 93) {
+                // Few trials: the reference plays each one out in full.
+                string line = "QUERY_PROJECTION TOP " + to_string(pick(0, team_count + 1));
+                if (pick(0, 3)) {
+                    line += " TRIALS " + to_string(pick(0, 40));
+                }
+                lines.push_back(line);
+            } else if (roll < 96) {
+                lines.push_back("WATCH " + team());
+            } else {
+                lines.push_back("UNWATCH " + team());
+            }
+        }
+        lines.push_back("FREEZE");
+        lines.push_back("QUERY_PROJECTION TOP " + to_string(pick(1, 3)) + " TRIALS 64");
+        lines.push_back("SCROLL");
+        lines.push_back("QUERY_PROBLEMS");
+        lines.push_back("END");
+        lines.push_back("FLUSH");
+        return lines;
+    }
+
+private:
+    mt19937_64 rng;
+    vector<string> names;
+
+    int pick(int low, int high) { return uniform_int_distribution<int>(low, high)(rng); }
+
+    string team() {
+        return pick(0, 30) == 0 ? "nobody" : names[pick(0, static_cast<int>(names.size()) - 1)];
+    }
+
+    string problem(int problem_count) {
+        return problem_name(pick(0, 40) == 0 ? problem_count : pick(0, problem_count - 1));
+    }
+
+    string filter_problem(int problem_count) { return pick(0, 3) == 0 ? "ALL" : problem(problem_count); }
+
+    string filter_status() {
+        int roll = pick(0, 9);
+        if (roll < 3) return "ALL";
+        if (roll == 3) return "Pending";
+        return kStatuses[roll % 4];
+    }
+};
+
+string replay(const vector<string>& lines, const ContestOptions& options, ContestFactory factory) {
+    ostringstream out;
+    ICPCManagement system(options, out, factory);
+    for (const auto& line : lines) {
+        if (execute_command(system, line) == CommandType::End) break;
+    }
+    return out.str();
+}
+
+// Prints the first line where the outputs part.
+void report_mismatch(const string& expected, const string& actual, const char* expected_name,
+                     const char* actual_name) {
+    istringstream expected_in(expected), actual_in(actual);
+    string expected_line, actual_line;
+    for (int line_no = 1;; line_no++) {
+        bool has_expected = static_cast<bool>(getline(expected_in, expected_line));
+        bool has_actual = static_cast<bool>(getline(actual_in, actual_line));
+        if (!has_expected && !has_actual) return;
+        if (!has_expected || !has_actual || expected_line != actual_line) {
+            cout << "  output line " << line_no << "\n"
+                 << "    " << expected_name << ": " << (has_expected ? expected_line : "<end>") << "\n"
+                 << "    " << actual_name << ": " << (has_actual ? actual_line : "<end>") << "\n";
+            return;
+        }
+    }
+}
+
+double timed_replay(const WorkloadConfig& config, const ContestOptions& options, ContestFactory factory) {
+    ostringstream out;
+    ICPCManagement system(options, out, factory);
+    WorkloadGenerator workload(config);
+    string line;
+    auto started = chrono::steady_clock::now();
+    while (workload.next(line)) {
+        execute_command(system, line);
+    }
+    return chrono::duration<double>(chrono::steady_clock::now() - started).count();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    long long cases = 1000;
+    uint64_t seed = 1;
+    bool history = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--history") {
+            history = true;
+            continue;
+        }
+        try {
+            if (arg.rfind("--cases=", 0) == 0) {
+                cases = stoll(arg.substr(8));
+                continue;
+            }
+            if (arg.rfind("--seed=", 0) == 0) {
+                seed = stoull(arg.substr(7));
+                continue;
+            }
+        } catch (...) {
+        }
+        cerr << "usage: " << argv[0] << " [--cases=N] [--seed=N] [--history]\n";
+        return 2;
+    }
+
+    vector<ContestOptions> option_sets;
+    for (const auto& args : kOptionSets) {
+        ContestOptions options;
+        for (const auto& arg : args) {
+            parse_option(arg, options);
+        }
+        option_sets.push_back(options);
+    }
+
+    for (long long i = 0; i < cases; i++) {
+        vector<string> lines = CaseGenerator(seed + i).generate();
+        if (history) {
+            lines.erase(remove_if(lines.begin(), lines.end(),
+                                  [](const string& line) { return line.rfind("QUERY_SUBMISSIONS ", 0) == 0; }),
+                        lines.end());
+        }
+        for (size_t set = 0; set < option_sets.size(); set++) {
+            string expected, actual;
+            if (history) {
+                ContestOptions summaries = option_sets[set];
+                summaries.keep_history = false;
+                expected = replay(lines, option_sets[set], make_contest);
+                actual = replay(lines, summaries, make_contest);
+            } else {
+                expected = replay(lines, option_sets[set], make_reference_contest);
+                actual = replay(lines, option_sets[set], make_contest);
+            }
+            if (expected == actual) continue;
+
+            cout << "mismatch: seed " << seed + i << ", options";
+            for (const auto& arg : kOptionSets[set]) {
+                cout << " " << arg;
+            }
+            cout << (kOptionSets[set].empty() ? " (default)\n" : "\n");
+            if (history) {
+                report_mismatch(expected, actual, "history   ", "no-history");
+            } else {
+                report_mismatch(expected, actual, "reference", "engine   ");
+            }
+            return 1;
+        }
+    }
+    cout << cases << " cases x " << option_sets.size() << " option sets agree"
+         << (history ? " with and without history\n" : "\n");
+    if (history) return 0;
+
+    WorkloadConfig config;
+    config.teams = 2000;
+    config.submissions = 100000;
+    config.flushes = 200;
+    config.queries = 2000;
+    double reference = timed_replay(config, ContestOptions(), make_reference_contest);
+    double engine = timed_replay(config, ContestOptions(), make_contest);
+    printf("teams=%lld submissions=%lld: reference %.2f s, engine %.2f s, %.1fx\n", config.teams,
+           config.submissions, reference, engine, reference / max(engine, 1e-9));
+    return 0;
+}
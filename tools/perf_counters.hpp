@@ -0,0 +1,113 @@
+#pragma once
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Hardware counters for this thread, opened as one perf_event group so all
+// of them count over exactly the same intervals. User-space only, which
+// works with the default perf_event_paranoid of 2. Opening fails without a
+// PMU (most VMs and containers); error() then says why and every read is
+// zero. The dTLB event is missing on some PMUs that have the others, so it
+// is opened on its own, outside the group; without it available() is false
+// for that counter alone.
+class PerfCounters {
+public:
+    static constexpr int kCount = 5;
+    // Counters 0 to kGroupCount - 1 form the group; the rest stand alone.
+    static constexpr int kGroupCount = 4;
+    using Values = std::array<std::uint64_t, kCount>;
+
+    static const char* name(int index) {
+        static const char* const names[kCount] = {"cycles", "instructions", "cache_misses",
+                                                  "branch_misses", "dtlb_misses"};
+        return names[index];
+    }
+
+    PerfCounters() {
+        static const std::uint32_t types[kCount] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                                    PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                                    PERF_TYPE_HW_CACHE};
+        static const std::uint64_t configs[kCount] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES,
+            PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)};
+        for (int i = 0; i < kCount; i++) {
+            bool grouped = i < kGroupCount;
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = types[i];
+            attr.config = configs[i];
+            attr.read_format = grouped ? PERF_FORMAT_GROUP : 0;
+            attr.disabled = i == 0 || !grouped;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            int group = i == 0 || !grouped ? -1 : fds[0];
+            int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+            if (fd < 0 && !grouped) continue;
+            if (fd < 0) {
+                failure = std::string("perf_event_open(") + name(i) + "): " + std::strerror(errno);
+                close_all();
+                return;
+            }
+            fds[i] = fd;
+        }
+        ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        for (int i = kGroupCount; i < kCount; i++) {
+            if (fds[i] < 0) continue;
+            ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    ~PerfCounters() { close_all(); }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool ok() const { return fds[0] >= 0; }
+    const std::string& error() const { return failure; }
+    // Whether counter `index` opened; its reads are zero otherwise.
+    bool available(int index) const { return fds[index] >= 0; }
+
+    // Running totals since the counters were enabled.
+    Values read() const {
+        Values values{};
+        if (!ok()) return values;
+        // PERF_FORMAT_GROUP: the member count, then one value per member.
+        std::uint64_t buffer[1 + kGroupCount];
+        if (::read(fds[0], buffer, sizeof(buffer)) == static_cast<ssize_t>(sizeof(buffer))) {
+            for (int i = 0; i < kGroupCount; i++) {
+                values[i] = buffer[1 + i];
+            }
+        }
+        for (int i = kGroupCount; i < kCount; i++) {
+            std::uint64_t value = 0;
+            if (fds[i] >= 0 && ::read(fds[i], &value, sizeof(value)) == sizeof(value)) {
+                values[i] = value;
+            }
+        }
+        return values;
+    }
+
+private:
+    int fds[kCount] = {-1, -1, -1, -1, -1};
+    std::string failure;
+
+    void close_all() {
+        for (int& fd : fds) {
+            if (fd >= 0) close(fd);
+            fd = -1;
+        }
+    }
+};
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "problem_id.hpp"
+#include "workload.hpp"
+
+// Named worst cases for the engine's slow paths. Each scenario is a fixed
+// sequence of phases; a phase emits `count` lines computed from their index,
+// so a scenario streams like WorkloadGenerator and never holds its input.
+// Sizes come from the same WorkloadConfig: teams, problems, submissions
+// (per heavy team), flushes (rounds) and queries.
+class ScenarioGenerator {
+public:
+    static const std::vector<std::string>& names() {
+        static const std::vector<std::string> all = {"frozen-all", "deep-ties", "heavy-team",
+                                                     "flush-all-dirty", "watch-scroll"};
+        return all;
+    }
+
+    // Returns false for an unknown name.
+    bool select(const std::string& name, const WorkloadConfig& workload_config) {
+        config = workload_config;
+        config.problems = std::min(std::max(config.problems, 1), kMaxProblems);
+        phases.clear();
+        phase = 0;
+        emitted = 0;
+
+        if (name == "frozen-all") {
+            frozen_all(false);
+        } else if (name == "deep-ties") {
+            deep_ties();
+        } else if (name == "heavy-team") {
+            heavy_team();
+        } else if (name == "flush-all-dirty") {
+            flush_all_dirty();
+        } else if (name == "watch-scroll") {
+            frozen_all(true);
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    bool next(std::string& line) {
+        while (phase < phases.size() && emitted == phases[phase].count) {
+            phase++;
+            emitted = 0;
+        }
+        if (phase == phases.size()) return false;
+        phases[phase].line(emitted++, line);
+        return true;
+    }
+
+private:
+    struct Phase {
+        long long count;
+        std::function<void(long long, std::string&)> line;
+    };
+
+    WorkloadConfig config;
+    std::vector<Phase> phases;
+    size_t phase = 0;
+    long long emitted = 0;
+
+    static std::string submit(int problem, long long team, bool accepted, long long time) {
+        return "SUBMIT " + problem_name(problem) + " BY " + WorkloadGenerator::team_name(team) +
+               " WITH " + (accepted ? "Accepted" : "Wrong_Answer") + " AT " + std::to_string(time);
+    }
+
+    void add(long long count, std::function<void(long long, std::string&)> line) {
+        phases.push_back({count, std::move(line)});
+    }
+
+    void add(const std::string& command) {
+        add(1, [command](long long, std::string& line) { line = command; });
+    }
+
+    void roster() {
+        add(config.teams, [](long long i, std::string& line) {
+            line = "ADDTEAM " + WorkloadGenerator::team_name(i);
+        });
+        add("START DURATION " + std::to_string(config.duration) + " PROBLEM " +
+            std::to_string(config.problems));
+    }
+
+    // Every team has every problem frozen when SCROLL starts, and every
+    // reveal is a solve, so the lowest team climbs at each step. With
+    // `watch`, the first `queries` teams are watched through the scroll.
+    void frozen_all(bool watch) {
+        roster();
+        if (watch) {
+            add(std::min(config.queries, config.teams), [](long long i, std::string& line) {
+                line = "WATCH " + WorkloadGenerator::team_name(i);
+            });
+        }
+        add("FREEZE");
+        long long teams = config.teams;
+        int problems = config.problems;
+        int duration = config.duration;
+        // Submissions go out problem by problem, so times never decrease.
+        add(2 * teams * problems, [teams, problems, duration](long long i, std::string& line) {
+            long long problem = i / (2 * teams);
+            long long team = i / 2 % teams;
+            long long time = 1 + problem * (duration - 1) / problems;
+            line = submit(static_cast<int>(problem), team, i % 2 == 1, time);
+        });
+        add("SCROLL");
+        add("END");
+    }
+
+    // Every team solves every problem at the same times, so comparisons run
+    // through the whole solve-time list before falling back to names. The
+    // last problem is solved during the freeze to make SCROLL compare equal
+    // keys too.
+    void deep_ties() {
+        roster();
+        long long teams = config.teams;
+        int problems = config.problems;
+        add((problems - 1) * teams, [teams](long long i, std::string& line) {
+            line = submit(static_cast<int>(i / teams), i % teams, true, 1 + i / teams);
+        });
+        add("FLUSH");
+        add(config.queries, [teams](long long i, std::string& line) {
+            line = "QUERY_RANKING " + WorkloadGenerator::team_name(i * 7919 % teams);
+        });
+        add("FREEZE");
+        add(teams, [problems](long long i, std::string& line) {
+            line = submit(problems - 1, i, true, problems);
+        });
+        add("SCROLL");
+        add("END");
+    }
+
+    // One team sends `submissions` submissions. Only the first is an
+    // accepted A, so every query below scans the team's whole history.
+    void heavy_team() {
+        roster();
+        long long submissions = std::max(1LL, config.submissions);
+        int problems = config.problems;
+        int duration = config.duration;
+        add(submissions, [submissions, problems, duration](long long i, std::string& line) {
+            int problem = i == 0 || problems == 1 ? 0 : 1 + static_cast<int>(i % (problems - 1));
+            line = submit(problem, 0, i == 0, 1 + i * (duration - 1) / submissions);
+        });
+        std::string team = WorkloadGenerator::team_name(0);
+        std::string range = " BETWEEN 1 AND " + std::to_string(duration);
+        add(config.queries, [team, range](long long i, std::string& line) {
+            if (i % 2 == 0) {
+                line = "QUERY_SUBMISSION " + team + " WHERE PROBLEM=A AND STATUS=Accepted";
+            } else {
+                line = "QUERY_SUBMISSIONS " + team + range + " WHERE PROBLEM=A AND STATUS=Accepted";
+            }
+        });
+        add("END");
+    }
+
+    // Every team solves one more problem between consecutive flushes, so
+    // each FLUSH re-sorts the whole board instead of a few changed teams.
+    void flush_all_dirty() {
+        roster();
+        long long teams = config.teams;
+        long long rounds = std::min<long long>(std::max(1LL, config.flushes), config.problems);
+        int duration = config.duration;
+        add(rounds * (teams + 1), [teams, rounds, duration](long long i, std::string& line) {
+            long long round = i / (teams + 1);
+            long long team = i % (teams + 1);
+            if (team == teams) {
+                line = "FLUSH";
+                return;
+            }
+            // Solve times rise through the round and the solve order flips
+            // every round, so the board keeps reshuffling.
+            long long time = 1 + (round * teams + team) * (duration - 1) / (rounds * teams);
+            long long solver = round % 2 == 0 ? team : teams - 1 - team;
+            line = submit(static_cast<int>(round), solver, true, time);
+        });
+        add("END");
+    }
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+
+#include "problem_id.hpp"
+
+// Shape of a synthetic contest. Submissions are spread evenly over the
+// contest; FLUSH and QUERY_* commands are interleaved at fixed strides and
+// the board is frozen for the last freeze_fraction of the submissions.
+struct WorkloadConfig {
+    long long teams = 10000;
+    int problems = 26;
+    long long submissions = 300000;
+    long long flushes = 1000;
+    long long queries = 10000;
+    double accept_rate = 0.3;
+    double freeze_fraction = 0.2;
+    int duration = 100000;
+    std::uint64_t seed = 1;
+};
+
+// Produces the command stream one line at a time, so contests far larger
+// than memory can still be replayed.
+class WorkloadGenerator {
+public:
+    explicit WorkloadGenerator(const WorkloadConfig& workload_config)
+        : config(workload_config), rng(workload_config.seed) {
+        flush_stride = config.flushes > 0 ? std::max(1LL, config.submissions / config.flushes) : 0;
+        query_stride = config.queries > 0 ? std::max(1LL, config.submissions / config.queries) : 0;
+        freeze_at = static_cast<long long>(config.submissions * (1.0 - config.freeze_fraction));
+    }
+
+    static std::string team_name(long long id) { return "team" + std::to_string(id); }
+
+    bool next(std::string& line) {
+        switch (phase) {
+        case Phase::Roster:
+            line = "ADDTEAM " + team_name(emitted++);
+            if (emitted == config.teams) phase = Phase::Start;
+            return true;
+        case Phase::Start:
+            line = "START DURATION " + std::to_string(config.duration) + " PROBLEM " +
+                   std::to_string(config.problems);
+            emitted = 0;
+            phase = Phase::Contest;
+            return true;
+        case Phase::Contest:
+            return next_contest_line(line);
+        case Phase::Scroll:
+            line = "SCROLL";
+            phase = Phase::End;
+            return true;
+        case Phase::End:
+            line = "END";
+            phase = Phase::Done;
+            return true;
+        case Phase::Done:
+            break;
+        }
+        return false;
+    }
+
+private:
+    enum class Phase { Roster, Start, Contest, Scroll, End, Done };
+
+    WorkloadConfig config;
+    std::mt19937_64 rng;
+    Phase phase = Phase::Roster;
+    long long emitted = 0;
+    long long flush_stride = 0;
+    long long query_stride = 0;
+    long long freeze_at = 0;
+    // Interleaved commands still owed after the current submission.
+    bool flush_due = false;
+    bool query_due = false;
+    bool frozen = false;
+
+    long long random_team() { return static_cast<long long>(rng() % config.teams); }
+
+    bool next_contest_line(std::string& line) {
+        if (!frozen && config.freeze_fraction > 0 && emitted >= freeze_at) {
+            frozen = true;
+            line = "FREEZE";
+            return true;
+        }
+        if (flush_due) {
+            flush_due = false;
+            line = "FLUSH";
+            return true;
+        }
+        if (query_due) {
+            query_due = false;
+            if (rng() % 4 == 0) {
+                line = "QUERY_SUBMISSION " + team_name(random_team()) + " WHERE PROBLEM=" +
+                       problem_name(static_cast<int>(rng() % config.problems)) + " AND STATUS=ALL";
+            } else {
+                line = "QUERY_RANKING " + team_name(random_team());
+            }
+            return true;
+        }
+        if (emitted == config.submissions) {
+            phase = frozen ? Phase::Scroll : Phase::End;
+            return next(line);
+        }
+
+        int time = 1 + static_cast<int>(emitted * config.duration / std::max(1LL, config.submissions));
+        bool accepted = std::uniform_real_distribution<double>(0, 1)(rng) < config.accept_rate;
+        line = "SUBMIT " + problem_name(static_cast<int>(rng() % config.problems)) + " BY " +
+               team_name(random_team()) + " WITH " + (accepted ? "Accepted" : "Wrong_Answer") +
+               " AT " + std::to_string(time);
+
+        emitted++;
+        flush_due = flush_stride && emitted % flush_stride == 0;
+        query_due = query_stride && emitted % query_stride == 0;
+        return true;
+    }
+};